@@ -1,9 +1,17 @@
 #include "h8-3069-iodef.h"
+#include "ad.h"
+#include "fastram.h"
+#include "ring.h"
 
 void ad_init();
 void ad_start(unsigned char ch, unsigned char int_sw);
 void ad_scan(unsigned char ch_grp, unsigned char int_sw);
 void ad_stop(void);
+void ad_dma_init(int chnum);
+int ad_dma_index(void) FASTCODE;
+void ad_cont_start(unsigned char ch_grp, int chnum);
+void ad_sync_start(unsigned char ch_grp, int chnum, int phase);
+void ad_latest(struct ad_sample *s) FASTCODE;
 
 void ad_init()
      /* A/D 変換器を使うための初期化関数 */
@@ -53,3 +61,138 @@ void ad_stop(void)
 {
   ADCSR = ADCSR & 0x5f;  /* A/Dエンドフラグのクリア, 変換停止 */
 }
+
+/* DMAC のショートアドレスモードの各チャネル(0A,0B,1A,1B)のレジスタ */
+/* MAR(4バイト), ETCRH, ETCRL, IOAR, DTCR の順に8バイトずつ並んでいる */
+static volatile unsigned char * const ad_dmareg[ADDMACHMAX] FASTCONST = {
+  &MAR0AR, &MAR0BR, &MAR1AR, &MAR1BR
+};
+#define DMA_MARE  1
+#define DMA_MARH  2
+#define DMA_MARL  3
+#define DMA_ETCRH 4
+#define DMA_ETCRL 5
+#define DMA_IOAR  6
+#define DMA_DTCR  7
+
+/* DTCR の設定                                              */
+/*   DTE=1, ワード転送, MAR を増加, リピートモード(RPE=1,   */
+/*   DTIE=0), 起動要因は A/D変換終了割り込み(DTS=011)       */
+/* ADDRxH, ADDRxL を1回のワード転送で読むので10ビットとも揃う */
+#define DMA_DTCR_ADI 0xd3
+
+/* DMAC の転送先と int_imia0() から読む状態は内蔵RAMに置く (fastram.h) */
+volatile unsigned short ad_dmabuf[ADDMACHMAX][ADDMABUFSIZE] FASTDATA;
+static int ad_dmachnum FASTDATA;
+
+/* ad_latest() が数えるスキャンの通し番号と, そのときの段の番号 */
+static unsigned long ad_seq FASTDATA;
+static int ad_seqidx FASTDATA;
+
+/* ad_sync_start() で指定した読み出す位相 (PWM と同期しないときは -1) */
+static int ad_syncphase FASTDATA = -1;
+
+void ad_dma_init(int chnum)
+     /* A/D変換終了で DMAC を起動し, 変換結果をリングバッファに転送する */
+     /* ように設定する関数                                             */
+     /* チャネル n (0-chnum-1) の ADDRx を ad_dmabuf[n][] に順に書き込み,  */
+     /* ADDMABUFSIZE 回転送すると MAR と ETCRH が元に戻る(リピートモード) */
+     /* この後 ad_scan(ch_grp, 1) でスキャンを開始すれば, 変換終了ごとに  */
+     /* CPU を介さずに転送され, int_adi() は呼ばれない                   */
+{
+  volatile unsigned char *r;
+  unsigned long adr;
+  int n;
+
+  if (chnum > ADDMACHMAX) chnum = ADDMACHMAX;
+  ad_dmachnum = chnum;
+  for (n = 0; n < chnum; n++) {
+    r = ad_dmareg[n];
+    r[DMA_DTCR] = 0x00;                 /* 転送禁止にしてから設定する */
+    adr = (unsigned long)ad_dmabuf[n];
+    r[DMA_MARE] = (adr >> 16) & 0xff;
+    r[DMA_MARH] = (adr >> 8) & 0xff;
+    r[DMA_MARL] = adr & 0xff;
+    r[DMA_ETCRH] = ADDMABUFSIZE;        /* 転送カウンタ */
+    r[DMA_ETCRL] = ADDMABUFSIZE;        /* カウンタの初期値(リロード用) */
+    r[DMA_IOAR] = 0xe0 + 2 * n;         /* ADDRA, ADDRB, ... の下位8ビット */
+    r[DMA_DTCR] = DMA_DTCR_ADI;
+  }
+  ad_seq = 0;
+  ad_seqidx = ADDMABUFSIZE - 1;         /* 最初の転送は段 0 に入る */
+}
+
+int ad_dma_index(void)
+     /* 全てのチャネルの転送が終わった最新の段の番号を返す関数        */
+     /* 同じ起動要因のチャネルは 0A,0B,1A,1B の順に転送されるので,    */
+     /* 最後に転送されるチャネルの ETCRH から求める                   */
+     /* ETCRH は残りの転送回数で, 0 になると ADDMABUFSIZE に戻る      */
+{
+  int rest;
+
+  if (ad_dmachnum <= 0) return 0;
+  rest = ad_dmareg[ad_dmachnum - 1][DMA_ETCRH];
+  return ring_wrap(ADDMABUFSIZE, ADDMABUFSIZE - 1 - rest);
+}
+
+void ad_cont_start(unsigned char ch_grp, int chnum)
+     /* A/D変換器を連続スキャンで動かし続ける関数                      */
+     /* ch_grp:入力チャネルグループ指定(0,1), chnum:スキャンするチャネル数(1-4) */
+     /*   グループの先頭から chnum 個(ch_grp=0 なら AN0-AN(chnum-1))だけを   */
+     /*   変換するので, 1回のスキャンは chnum x 134 ステートで終わる         */
+     /* 変換終了ごとに DMAC がリングバッファに転送し, 割り込みは発生しない  */
+     /* 最新の値は ad_latest() で読む                                      */
+{
+  if (chnum < 1) chnum = 1;
+  if (chnum > ADDMACHMAX) chnum = ADDMACHMAX;
+  ADCSR = ADCSR & 0x5f;                 /* エンドフラグのクリアと変換の停止 */
+  ADCR = ADCR & 0x7f;                   /* 外部トリガ変換開始の禁止 */
+  ad_dma_init(chnum);
+  ad_syncphase = -1;
+  ch_grp = (ch_grp != 0) ? 4 : 0;
+  ADCSR = 0x78 | ch_grp | (chnum - 1);  /* 割り込み(DMAC の起動)許可, スキャン開始 */
+}
+
+void ad_sync_start(unsigned char ch_grp, int chnum, int phase)
+     /* PWM の周期に同期してA/D変換器を連続スキャンで動かす関数          */
+     /* 8ビットタイマ ch0 のコンペアマッチA(motor.c の PWM の周期の始め)  */
+     /* で最初のスキャンを開始させる (TCSR0 の ADTE と ADCR の TRGE)      */
+     /* 4チャネルのスキャンは2回目以降 4 x 128 = 512 ステートで一定なので, */
+     /* PWM の周期 2048 ステート(motor.h の MOTOR_PWMPERIOD)にちょうど    */
+     /* 4回入り, 以後のスキャンも PWM に対して同じ位相で繰り返される      */
+     /* そのため chnum に関わらずグループの4チャネルをスキャンする        */
+     /* DMAC で取り込むのは先頭の chnum 個のチャネルだけ                 */
+{
+  ADCSR = ADCSR & 0x5f;                 /* エンドフラグのクリアと変換の停止 */
+  ad_dma_init(chnum);
+  ad_syncphase = phase & (ADSYNCSCANS - 1);
+  ch_grp = (ch_grp != 0) ? 4 : 0;
+  ADCSR = 0x58 | ch_grp | 3;            /* 割り込み(DMAC の起動)許可, 変換は停止のまま */
+  T8TCSR0 = T8TCSR0 | 0x10;             /* コンペアマッチAでA/D変換を起動 */
+  ADCR = ADCR | 0x80;                   /* 外部トリガ変換開始の許可 */
+}
+
+void ad_latest(struct ad_sample *s)
+     /* 最新のスキャンの結果を通し番号をつけて読み出す関数               */
+     /* 割り込みを禁止しなくても, 全チャネルが同じスキャンの値になる     */
+     /* 通し番号は前回の呼び出しからの段の進みを足して数えるので,        */
+     /* ADDMABUFSIZE 回のスキャンが終わる前に(1ms ごとなら十分)次を呼ぶこと */
+     /* 通し番号を数えるので, 呼び出すのは1か所(割り込みハンドラ)にする   */
+{
+  int idx, n;
+
+  idx = ad_dma_index();
+  ad_seq += ring_wrap(ADDMABUFSIZE, idx - ad_seqidx);
+  ad_seqidx = idx;
+  s->seq = ad_seq;
+  s->step = 1;
+  if (ad_syncphase >= 0) {
+    /* 一度始まればスキャンは止まらないので, トリガはもう使わない */
+    if ((ADCR & 0x80) && (ADCSR & 0x20)) ADCR = ADCR & 0x7f;
+    /* 段 0 が周期の最初のスキャンなので, 段の番号の下位2ビットが位相 */
+    idx = ring_wrap(ADDMABUFSIZE, idx - ring_wrap(ADSYNCSCANS, idx - ad_syncphase));
+    s->step = ADSYNCSCANS;
+  }
+  s->idx = idx;
+  for (n = 0; n < ad_dmachnum; n++) s->val[n] = ad_dmabuf[n][idx] >> (16 - ADBITS);
+}
@@ -13,3 +13,42 @@ extern void ad_init();
 extern void ad_start(unsigned char ch, unsigned char int_sw);
 extern void ad_scan(unsigned char ch_grp, unsigned char int_sw);
 extern void ad_stop(void);
+
+/* 変換結果のビット数と最大値 */
+#define ADBITS 10
+#define ADMAX  ((1 << ADBITS) - 1)
+
+/* DMAC による変換結果の取り込み (ad_dma_init() を参照) */
+#define ADDMACHMAX   4       /* 取り込めるチャネル数(DMAC のショートアドレスモード) */
+#define ADDMABUFSIZE 128     /* リングバッファの段数 (2のべき乗, 128以下, 添字は ring.h の ring_wrap()) */
+
+/* ad_sync_start() のときの PWM の1周期あたりのスキャン回数 */
+#define ADSYNCSCANS  4
+
+/* ad_latest() で読み出す最新のスキャンの結果 */
+struct ad_sample {
+  unsigned long seq;                 /* スキャンの通し番号(1から) */
+  int idx;                           /* リングバッファの段の番号 */
+  int step;                          /* 同じ位相の前のスキャンまでの段数 */
+  unsigned short val[ADDMACHMAX];    /* 各チャネルの変換結果(0-ADMAX) */
+};
+
+extern volatile unsigned short ad_dmabuf[ADDMACHMAX][ADDMABUFSIZE];
+     /* チャネルごとのリングバッファ (DMAC が ADDRx をそのまま書き込む) */
+     /* 変換結果は上位 ADBITS ビットに左詰めで入っている               */
+extern void ad_dma_init(int chnum);
+     /* A/D変換終了で DMAC を起動し, ADDRA から chnum 個のチャネルの */
+     /* 変換結果(10ビット)を ad_dmabuf[][] に転送するように設定する    */
+extern int ad_dma_index(void);
+     /* 全チャネルの転送が終わった最新の段の番号を返す */
+extern void ad_cont_start(unsigned char ch_grp, int chnum);
+     /* グループ ch_grp(0,1)の先頭 chnum 個のチャネルを連続スキャンし,   */
+     /* 結果を DMAC で ad_dmabuf[][] に取り込み続ける (割り込みなし)     */
+extern void ad_sync_start(unsigned char ch_grp, int chnum, int phase);
+     /* ad_cont_start() と同じだが, 8ビットタイマ ch0 のコンペアマッチA   */
+     /* (PWM の周期の始め)でスキャンを開始し, PWM と位相を揃えて変換する  */
+     /* phase(0-ADSYNCSCANS-1): PWM の周期を4等分したうちの何番目の     */
+     /*   スキャンを ad_latest() で読むか                                */
+extern void ad_latest(struct ad_sample *s);
+     /* 最新のスキャンの全チャネルの値と通し番号を *s に読み出す          */
+     /* 通し番号は ADDMABUFSIZE 回のスキャンより短い間隔で呼んで数える   */
@@ -0,0 +1,65 @@
+#include "estimator.h"
+#include "fastram.h"
+
+void est_init(struct est *e, int alpha, int beta, int sat);
+void est_reset(struct est *e, int m) FASTCODE;
+void est_update(struct est *e, int m, int valid) FASTCODE;
+
+void est_init(struct est *e, int alpha, int beta, int sat)
+     /* 推定器の初期化関数 */
+{
+  e->alpha = alpha;
+  e->beta = beta;
+  e->sat = sat;
+  est_reset(e, 0);
+}
+
+void est_reset(struct est *e, int m)
+     /* 推定をやり直す関数 */
+{
+  e->x = (long)m << EST_SHIFT;
+  e->v = 0;
+  e->lost = 0;
+}
+
+void est_update(struct est *e, int m, int valid)
+     /* 推定を1周期進める関数                                   */
+     /* 割り込みハンドラから呼ぶので乗算とシフトだけで計算する   */
+     /*   ・m が sat の 7/8 以上で予測がそれより外側なら, 真の位置 */
+     /*     は m より外側かもしれないので修正しない              */
+     /*   ・|m| が sat/8 未満(ほぼ両方白)で予測が sat/2 より外側  */
+     /*     なら, ラインが外へ抜けたとみなして修正しない          */
+{
+  long xp, r, lim;
+  int edge;
+
+  xp = e->x + e->v;
+  edge = e->sat - (e->sat >> 3);
+  if (valid) {
+    if (m >= edge && xp > ((long)m << EST_SHIFT)) valid = 0;
+    else if (m <= -edge && xp < ((long)m << EST_SHIFT)) valid = 0;
+    else if (m < (e->sat >> 3) && m > -(e->sat >> 3) &&
+             (xp > ((long)e->sat << (EST_SHIFT - 1)) ||
+              xp < -((long)e->sat << (EST_SHIFT - 1)))) valid = 0;
+  }
+
+  if (valid) {
+    r = ((long)m << EST_SHIFT) - xp;
+    e->x = xp + ((e->alpha * r) >> EST_SHIFT);
+    e->v += (e->beta * r) >> EST_SHIFT;
+    e->lost = 0;
+  } else {
+    e->x = xp;
+    e->lost++;
+  }
+
+  /* 外挿が発散しないように位置を制限し, 端に着いたら止める */
+  lim = (long)e->sat << (EST_SHIFT + 1);
+  if (e->x > lim) {
+    e->x = lim;
+    if (e->v > 0) e->v = 0;
+  } else if (e->x < -lim) {
+    e->x = -lim;
+    if (e->v < 0) e->v = 0;
+  }
+}
@@ -0,0 +1,32 @@
+// estimator.c を利用するために必要なヘッダファイル
+// 固定小数点(整数演算)の α-β フィルタでラインの位置と変化の速さを推定する
+//
+// 位置 x と速さ v (1制御周期あたりの変化)は 2^EST_SHIFT 倍した整数で持つ
+// 毎周期 x に v を足して予測し, 測定値 m との差に α, β を掛けて修正する
+//   x' = x + v,  r = m - x',  x = x' + α*r,  v = v + β*r
+// α, β は 2^EST_SHIFT 倍した整数で, 掛けた後はシフトで戻すので除算は使わない
+//
+// センサが飽和して測定値が使えないとき(両方黒, 片方が真っ黒のまま外側へ,
+// ラインが外へ抜けてほぼ両方白)は修正せずに外挿し, 位置を ±2*sat に制限する
+
+#define EST_SHIFT 8          /* 小数部のビット数 (1 = 256) */
+
+struct est {
+  long x;                    /* 推定した位置 x 2^EST_SHIFT */
+  long v;                    /* 推定した速さ(1周期あたり) x 2^EST_SHIFT */
+  int alpha, beta;           /* 修正のゲイン x 2^EST_SHIFT */
+  int sat;                   /* 片方のセンサが真っ黒になる測定値の大きさ */
+  int lost;                  /* 続けて外挿した周期数 */
+};
+
+extern void est_init(struct est *e, int alpha, int beta, int sat);
+     /* ゲインと飽和する測定値の大きさを設定し, 推定を 0 にする */
+extern void est_reset(struct est *e, int m);
+     /* 位置を m, 速さを 0 にする */
+extern void est_update(struct est *e, int m, int valid);
+     /* 測定値 m で推定を1周期進める (1制御周期に1回呼ぶ)      */
+     /* valid が 0 のとき(両方黒など)は m を使わずに外挿する    */
+#define est_offset(e)  ((int)((e)->x >> EST_SHIFT))
+     /* 現在の位置の推定値 */
+#define est_predict(e) ((int)(((e)->x + (e)->v) >> EST_SHIFT))
+     /* 1周期先の位置の予測値 */
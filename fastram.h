@@ -0,0 +1,26 @@
+// 割り込み処理のコードと変数を内蔵RAMに置くためのヘッダファイル
+//
+// RAM_CAP=ext では .text, .data は外部RAM(8ビット幅, 3ステート)に置かれ,
+// 16ビットの命令やデータを読むたびに2回の遅いバスサイクルとリフレッシュの
+// 待ちがかかる. 内蔵RAMは16ビット幅, 2ステートなので, 1ms ごとに実行する
+// int_imia0() から呼ばれる関数とその変数だけをここに置く
+//
+// FASTCODE, FASTDATA, FASTCONST を付けた関数と変数は .fastcode, .fastdata,
+// .fastconst セクションに入り, リンカスクリプトの .fast セクションとして
+// 内蔵RAMに配置される. 初期値(0 も含む)は .data の後ろに置かれ, スタート
+// アップルーチンが main() を呼ぶ前に内蔵RAMへ転送する
+//   FASTCODE  : 関数 (プロトタイプ宣言の後ろに付ける)
+//   FASTDATA  : 変数 (初期値がなくても 0 に初期化される)
+//   FASTCONST : const の表 (同じファイルで FASTDATA と混ぜられないので別にする)
+// 内蔵RAMの残りは make のときに表示される (tools/ramreport.awk)
+
+#ifdef H8SIM
+/* ホスト上のシミュレータでは配置を変えない */
+#define FASTCODE
+#define FASTDATA
+#define FASTCONST
+#else
+#define FASTCODE  __attribute__ ((section (".fastcode")))
+#define FASTDATA  __attribute__ ((section (".fastdata")))
+#define FASTCONST __attribute__ ((section (".fastconst")))
+#endif
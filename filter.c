@@ -0,0 +1,60 @@
+#include "filter.h"
+#include "fastram.h"
+
+void filter_init(struct filter *f, int type, int shift, int x);
+int filter_put(struct filter *f, int x) FASTCODE;
+static int filter_median3(int a, int b, int c) FASTCODE;
+
+void filter_init(struct filter *f, int type, int shift, int x)
+     /* フィルタを初期化する関数                         */
+     /* 全ての内部状態を x が入り続けていた状態にする     */
+{
+  int i;
+
+  if (shift < 0) shift = 0;
+  if (shift > FILTER_SHIFTMAX) shift = FILTER_SHIFTMAX;
+  f->type = type;
+  f->shift = shift;
+  f->med[0] = f->med[1] = x;
+  ring_init(&f->win);
+  for (i = 0; i < FILTER_WINMAX; i++) ring_put(&f->win, x);
+  f->acc = (long)x << shift;
+  f->out = x;
+}
+
+static int filter_median3(int a, int b, int c)
+     /* 3個の値の中央値を返す関数 */
+{
+  if (a > b) {
+    if (b > c) return b;
+    return (a > c) ? c : a;
+  }
+  if (a > c) return a;
+  return (b > c) ? c : b;
+}
+
+int filter_put(struct filter *f, int x)
+     /* サンプル x を1個入れてフィルタの出力を更新する関数  */
+     /* 割り込みハンドラから呼ぶので除算やループは使わない  */
+{
+  int m;
+
+  if (f->type & FILTER_MEDIAN) {
+    m = filter_median3(x, f->med[0], f->med[1]);
+    f->med[1] = f->med[0];
+    f->med[0] = x;
+    x = m;
+  }
+  if (f->type & FILTER_AVR) {
+    /* 2^shift 個前の値(窓から出る一番古い値)と入れ替える */
+    f->acc += x - ring_last(&f->win, (1 << f->shift) - 1);
+    ring_put(&f->win, x);
+    f->out = f->acc >> f->shift;
+  } else if (f->type & FILTER_IIR) {
+    f->acc += x - (f->acc >> f->shift);
+    f->out = f->acc >> f->shift;
+  } else {
+    f->out = x;
+  }
+  return f->out;
+}
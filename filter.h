@@ -0,0 +1,37 @@
+// filter.c を利用するために必要なヘッダファイル
+// A/D変換の値などを1サンプルずつ入れて平滑化する整数演算のフィルタ
+//
+// サンプルが届くたびに filter_put() を呼ぶと出力が更新され,
+// 出力の読み出し filter_out() はメンバを1つ読むだけで済む
+// 移動平均は合計に新しい値を足して一番古い値を引くだけで更新し,
+// 1次 IIR も足し算とシフトだけで計算する (除算は使わない)
+
+/* フィルタの種類 (FILTER_AVR と FILTER_IIR のどちらか, または FILTER_NONE) */
+#define FILTER_NONE   0x00   /* 素通し */
+#define FILTER_AVR    0x01   /* 2^shift 個の移動平均 */
+#define FILTER_IIR    0x02   /* 1次 IIR  y += (x - y) / 2^shift */
+/* 上の種類に重ねて指定する前処理 */
+#define FILTER_MEDIAN 0x10   /* 直前の3個のメディアン(単発のノイズを除く) */
+
+#include "ring.h"
+
+#define FILTER_SHIFTMAX 4    /* shift の最大値 (移動平均は最大16個) */
+#define FILTER_WINMAX   (1 << FILTER_SHIFTMAX)
+
+struct filter {
+  unsigned char type;        /* FILTER_xxx の組み合わせ */
+  unsigned char shift;       /* 移動平均の個数, IIR の係数を決める(0-FILTER_SHIFTMAX) */
+  int med[2];                /* メディアン用の直前の2個の入力 */
+  RING(int, FILTER_WINMAX) win; /* 移動平均の窓 (直前の 2^shift 個を使う) */
+  long acc;                  /* 移動平均の合計, IIR の出力 x 2^shift */
+  int out;                   /* 出力 */
+};
+
+#define filter_out(f) ((f)->out)
+     /* フィルタの出力を返す (定数時間) */
+
+extern void filter_init(struct filter *f, int type, int shift, int x);
+     /* フィルタの種類と shift を設定し, 値 x が続いていた状態にする */
+     /* 実行中に設定を変えるときは, filter_put() と同時に呼ばないこと */
+extern int filter_put(struct filter *f, int x);
+     /* サンプル x を入れて出力を更新し, 新しい出力を返す */
@@ -6,8 +6,20 @@
 /*     ENINT1();  <= プライオリティ1の割り込み許可状態になる */
 /*     DISINT();  <= これ以降は全割り込み不許可状態になる    */
 /* 注意：この他に割り込みコントローラの設定が必要!!          */
+/*       (優先順位と入れ子の割り込みは intr.h を参照)         */
 
+#ifdef H8SIM
+/* ホスト上のシミュレータ(make sim)では CCR の代わりに sim/sim.c が */
+/* 割り込みマスクの状態を管理する                                  */
+/* 割り込みは優先順位 0 の int_imia0 しかないので, ENINT1() は何もしない */
+extern void h8sim_enint(void);
+extern void h8sim_disint(void);
+#define ENINT()   h8sim_enint()
+#define ENINT1()  ((void)0)
+#define DISINT()  h8sim_disint()
+#else
 #define ENINT()   asm volatile ("andc.b #0x7f,ccr") 
 #define ENINT1()  asm volatile ("andc.b #0xbf,ccr") 
 #define DISINT()  asm volatile ("orc.b #0x80,ccr")
+#endif
 #define ROMEMU()  RAMCR=0xf8
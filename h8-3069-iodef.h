@@ -1,4 +1,10 @@
 /* h8-3069-iodef.h */
+
+/* H8SIM を定義してホスト上でコンパイルするときは(make sim)         */
+/* レジスタを普通のメモリに置き換えた sim/h8-3069-iodef.h を使う   */
+#ifdef H8SIM
+#include "sim/h8-3069-iodef.h"
+#else
 /* H8300Hシリーズ3064の各レジスタ群の定義 */
 
 /*   putbyte, getbyte を使わなくてよい定義の仕方 */
@@ -429,3 +435,4 @@
 #define DACR (*(volatile unsigned char *)0xffff9e)
 /* D/Aスタンバイコントロールレジスタ */
 #define DASTCR (*(volatile unsigned char *)0xfee01A)
+#endif /* H8SIM */
@@ -41,6 +41,9 @@ MEMORY
     /*   RAMエミュレーション領域は 4kB */
     /*   スタック領域は残り(最後)の4kB */
     /* ram		: o = 0xffbf20, l = 0x020e0 */
+    /* 割り込み処理のコードと変数(.fast)を置く内蔵RAM */
+    /*   RAMエミュレーション領域の手前までの 8kB      */
+    fast	: o = 0xffbf20, l = 0x020e0
 }
 SECTIONS                
 {                   
@@ -160,4 +163,14 @@ SECTIONS
     *(COMMON)
     __bss_end = .;
     }  >ram
+/* 割り込み処理のコードと変数 → 外部RAM(.bss の後ろ) →(転送)→ 内蔵RAM */
+/*   内蔵RAMへの転送は、ramcrt-ext.s で行う (fastram.h 参照) */
+.fast : AT(__bss_end) {
+    __fast_start = .;
+    *(.fastcode)
+    *(.fastconst)
+    *(.fastdata)
+    __fast_end = .;
+    }  > fast
+__ifast_start = LOADADDR(.fast);
 }
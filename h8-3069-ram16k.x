@@ -154,6 +154,17 @@ SECTIONS
     *(.data)
     __edata = . ;
     }  > ram
+/* 割り込み処理のコードと変数 → 内蔵RAM */
+/*   全体が既に内蔵RAMにあるので、実行するアドレスにそのままロードする */
+/*   (転送は不要なので ramcrt-16k.s では何もしない, fastram.h 参照) */
+.fast : {
+    __fast_start = .;
+    *(.fastcode)
+    *(.fastconst)
+    *(.fastdata)
+    __fast_end = .;
+    }  > ram
+__ifast_start = LOADADDR(.fast);
 .bss : {
     __bss_start = .;
     *(.bss)
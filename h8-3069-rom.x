@@ -44,6 +44,11 @@ MEMORY
     /*   RAMエミュレーション領域は 4kB */
     /*   スタック領域は残り(最後)の4kB */
     /* ram		: o = 0xffbf20, l = 0x020e0 */
+    /* 割り込み処理のコードと変数(.fast)を置く内蔵RAM */
+    /*   スタックは外部RAMなので、内蔵RAMの 14kB を使える */
+    /*   ROM化では ROMエミュレーションをしない(main() は ROMEMU() を呼ばない) */
+    /*   ので、0xffe000-0xffefff も .fast に使える */
+    fast	: o = 0xffbf20, l = 0x03800
 }
 SECTIONS                
 {                   
@@ -169,4 +174,14 @@ SECTIONS
     *(COMMON)
     __bss_end = .;
     }  >ram
+/* 割り込み処理のコードと変数 → 内蔵ROM(.data の初期値の後ろ) →(転送)→ 内蔵RAM */
+/*   内蔵RAMへの転送は、romcrt-ext.s で行う (fastram.h 参照) */
+.fast : AT(__idata_start + SIZEOF(.data)) {
+    __fast_start = .;
+    *(.fastcode)
+    *(.fastconst)
+    *(.fastdata)
+    __fast_end = .;
+    }  > fast
+__ifast_start = LOADADDR(.fast);
 }
@@ -162,6 +162,17 @@ SECTIONS
     *(.data)
     __data_end = . ;
     }  > ram
+/* 割り込み処理のコードと変数 → 内蔵ROM(.data の初期値の後ろ) →(転送)→ 内蔵RAM */
+/*   内蔵RAMへの転送は、romcrt-16k.s で行う (fastram.h 参照) */
+/*   変数は .data と同じ内蔵RAMだが、コードも ROM から RAM に移る */
+.fast : AT(__idata_start + SIZEOF(.data)) {
+    __fast_start = .;
+    *(.fastcode)
+    *(.fastconst)
+    *(.fastdata)
+    __fast_end = .;
+    }  > ram
+__ifast_start = LOADADDR(.fast);
 /* 初期値をもたない変数 → RAM領域 */
 .bss : {
     __bss_start = .;
@@ -0,0 +1,22 @@
+#include "hist.h"
+#include "fastram.h"
+
+/* 0-255 の 1 のビットの数の表 */
+/* H8/300H のシフトは1命令1ビットなので, ビットをずらして足し合わせる */
+/* 方法より, 8ビット単位で表を引く方が速い                           */
+#define HIST_B2(n) n, n + 1, n + 1, n + 2
+#define HIST_B4(n) HIST_B2(n), HIST_B2(n + 1), HIST_B2(n + 1), HIST_B2(n + 2)
+#define HIST_B6(n) HIST_B4(n), HIST_B4(n + 1), HIST_B4(n + 1), HIST_B4(n + 2)
+static const unsigned char hist_bits[256] FASTCONST = {
+  HIST_B6(0), HIST_B6(1), HIST_B6(1), HIST_B6(2)
+};
+
+int hist_popcount(unsigned long x) FASTCODE;
+
+int hist_popcount(unsigned long x)
+     /* 1 のビットを数える関数 */
+     /* 8ビットずつのシフトはバイトの転送になる                 */
+{
+  return hist_bits[x & 0xff] + hist_bits[(x >> 8) & 0xff] +
+    hist_bits[(x >> 16) & 0xff] + hist_bits[(x >> 24) & 0xff];
+}
@@ -0,0 +1,20 @@
+// hist.c を利用するために必要なヘッダファイル
+// 1周期に1ビットずつ入れるシフトレジスタの履歴 (最大32周期)
+//
+// 新しいビットを最下位に入れて左へずらすので, ビット i が i 周期前になる
+// 「直前の n 周期のうち何回か」はマスクと AND とビット数えだけで求まり,
+// 配列の添字の剰余計算もループも要らない
+
+#define HIST_BITS 32         /* 履歴の長さ (unsigned long のビット数) */
+
+#define hist_push(h, b) ((h) = ((h) << 1) | ((b) ? 1 : 0))
+     /* 履歴 h (unsigned long の変数) に今の周期のビット b を入れる */
+#define hist_mask(n) ((n) >= HIST_BITS ? 0xffffffffUL : (1UL << (n)) - 1)
+     /* 直前の n 周期(今の周期を含む)を取り出すマスク */
+#define hist_now(h) ((int)((h) & 1))
+     /* 今の周期のビット */
+
+extern int hist_popcount(unsigned long x);
+     /* x の 1 のビットの数を返す (バイトごとの表を4回引く) */
+#define hist_count(h, n) hist_popcount((h) & hist_mask(n))
+     /* 直前の n 周期でビットが 1 だった回数 */
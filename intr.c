@@ -0,0 +1,37 @@
+#include "h8-3069-iodef.h"
+#include "intr.h"
+
+/* SYSCR の UE ビット (1 : UI はユーザビット, 0 : UI は割り込みマスク) */
+#define INTR_SYSCR_UE 0x08
+
+void intr_init(const struct intr_prio *table, int num);
+void intr_set(int src, int prio);
+
+void intr_init(const struct intr_prio *table, int num)
+     /* 割り込みの優先順位を設定する関数                          */
+     /* 全ての要因を優先順位 0 にしてから, 表の要因を設定し直す    */
+     /* UI は不定なので 0 にしておく (I はそのまま, 禁止のまま)    */
+{
+  int n;
+
+  IPRA = 0;
+  IPRB = 0;
+  for (n = 0; n < num; n++) intr_set(table[n].src, table[n].prio);
+  SYSCR &= ~INTR_SYSCR_UE;
+  ENINT1();
+}
+
+void intr_set(int src, int prio)
+     /* 要因 src の IPRA, IPRB のビットを書き換える関数 */
+{
+  unsigned char bit, lock;
+
+  bit = 0x80 >> (src & 7);
+  INTR_LOCK(lock);
+  if (src < 8) {
+    if (prio) IPRA |= bit; else IPRA &= ~bit;
+  } else {
+    if (prio) IPRB |= bit; else IPRB &= ~bit;
+  }
+  INTR_UNLOCK(lock);
+}
@@ -0,0 +1,71 @@
+// intr.c を利用するために必要なヘッダファイル
+// 割り込み要因ごとの優先順位と入れ子の割り込み, 必要な分だけ割り込みを
+// 禁止する区間 (h8-3069-int.h の ENINT(), DISINT() の上に作ってある)
+//
+// intr_init() は SYSCR の UE を 0 にし, CCR の UI を割り込みマスクに使う
+//   優先順位 1 の割り込み : I=0 または UI=0 のときに受け付ける
+//   優先順位 0 の割り込み : I=0 のときだけ受け付ける
+// 受け付けると, 優先順位によらず I と UI の両方が 1 になる
+// 優先順位 0 の割り込みハンドラ(int_imia0 の制御など)は, 割り込みフラグを
+// クリアしてから ENINT1() で UI を 0 にする. それ以降は優先順位 1 の
+// 割り込みハンドラが待たされずに入れ子で実行される (ENINT1() を呼ばない
+// ハンドラの実行中は, 優先順位 1 の割り込みも待たされる)
+// 優先順位 1 には短く, 遅れが許されない処理だけを割り当てること
+//
+// 割り込みハンドラと共有する変数を読み書きする区間は INTR_LOCK0() か
+// INTR_LOCK() で囲み, INTR_UNLOCK() で元の状態に戻す
+//   INTR_LOCK0(s) : 優先順位 0 の割り込みだけを禁止する (優先順位 1 は動く)
+//   INTR_LOCK(s)  : NMI 以外の全ての割り込みを禁止する
+//   INTR_UNLOCK(s): 区間に入る前の CCR の I, UI に戻す
+// s は unsigned char の変数. 元の状態に戻すので, 割り込みハンドラの中や
+// 入れ子の区間でも使える (DISINT(), ENINT() の組は必ず許可状態になる)
+
+#include "h8-3069-int.h"
+
+/* 割り込み要因 (IPRA7-0, IPRB7-0 の順の番号) */
+#define INTR_IRQ0   0        /* IPRA7 : IRQ0 */
+#define INTR_IRQ1   1        /* IPRA6 : IRQ1 */
+#define INTR_IRQ23  2        /* IPRA5 : IRQ2, IRQ3 */
+#define INTR_IRQ45  3        /* IPRA4 : IRQ4, IRQ5 */
+#define INTR_WDT    4        /* IPRA3 : ウォッチドッグタイマ, リフレッシュ */
+#define INTR_ITU0   5        /* IPRA2 : 16ビットタイマ ch0 */
+#define INTR_ITU1   6        /* IPRA1 : 16ビットタイマ ch1 */
+#define INTR_ITU2   7        /* IPRA0 : 16ビットタイマ ch2 */
+#define INTR_TMR01  8        /* IPRB7 : 8ビットタイマ ch0, ch1 */
+#define INTR_TMR23  9        /* IPRB6 : 8ビットタイマ ch2, ch3 */
+#define INTR_DMAC  10        /* IPRB5 : DMAC */
+#define INTR_SCI0  12        /* IPRB3 : SCI ch0 */
+#define INTR_SCI1  13        /* IPRB2 : SCI ch1 */
+#define INTR_AD    14        /* IPRB1 : A/D変換終了 */
+
+#define INTR_LOW   0         /* 優先順位 0 */
+#define INTR_HIGH  1         /* 優先順位 1 (優先順位 0 のハンドラに割り込める) */
+
+/* 優先順位の表の1行 (表にない要因は優先順位 0) */
+struct intr_prio {
+  unsigned char src;         /* INTR_IRQ0 - INTR_AD */
+  unsigned char prio;        /* INTR_LOW, INTR_HIGH */
+};
+
+#ifdef H8SIM
+/* ホスト上のシミュレータ(make sim)では sim/sim.c が割り込みマスクを管理する */
+/* 割り込みは int_imia0 (優先順位 0) しかないので, 2種類の区間は同じになる */
+extern unsigned char h8sim_intlock(void);
+extern void h8sim_intunlock(unsigned char s);
+#define INTR_LOCK(s)   ((s) = h8sim_intlock())
+#define INTR_LOCK0(s)  ((s) = h8sim_intlock())
+#define INTR_UNLOCK(s) h8sim_intunlock(s)
+#else
+#define INTR_LOCK(s) \
+  asm volatile ("stc ccr,%0\n\torc #0xc0,ccr" : "=r" (s) : : "cc", "memory")
+#define INTR_LOCK0(s) \
+  asm volatile ("stc ccr,%0\n\torc #0x80,ccr" : "=r" (s) : : "cc", "memory")
+#define INTR_UNLOCK(s) \
+  asm volatile ("ldc %0,ccr" : : "r" (s) : "cc", "memory")
+#endif
+
+extern void intr_init(const struct intr_prio *table, int num);
+     /* 表の優先順位を IPRA, IPRB に設定し, 入れ子の割り込みを使えるようにする */
+     /* 割り込みを許可する(ENINT())前に呼ぶこと                                */
+extern void intr_set(int src, int prio);
+     /* 要因 src の優先順位を変える */
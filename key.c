@@ -1,6 +1,8 @@
 #include "h8-3069-iodef.h"
+#include "fastram.h"
+#include "ring.h"
 
-#define KEYBUFSIZE 10  /* キーバッファの大きさ */
+#define KEYBUFSIZE  8  /* キーバッファの大きさ (2のべき乗, ring.h) */
 #define KEYCHKCOUNT 5  /* キーの連続状態を調べるバッファ上の長さ　 */
                          /* ↑キーバッファの大きさよりも小さくすること */
                          /*   余裕が少ないと正しく読めないことがある */
@@ -21,8 +23,11 @@
 
 /* タイマ割り込み処理のため, バッファ関連は大域変数として確保 */
 /* これらの変数は key.c 内のみで使用されている               */
-int keybufdp; /* キーバッファ参照ポインタ */
-unsigned char keybuf[KEYBUFSIZE][KEYROWNUM]; /* キーバッファ */
+/* キーバッファは key_sense() が1回のスキャンを書き終えてから公開する */
+struct keyscan {
+  unsigned char row[KEYROWNUM];   /* 列ごとのキーデータ (0:ON, 1:OFF) */
+};
+RING(struct keyscan, KEYBUFSIZE) keybuf FASTDATA; /* キーバッファ */
 
 /* これらの変数はキー処理だけに使用 */
 /* 処理の簡易化のために大域変数として確保 */
@@ -30,7 +35,7 @@ unsigned char keyoldval[KEYMAXNUM];
 unsigned char keynewval[KEYMAXNUM];
 
 void key_init(void);
-void key_sense(void);
+void key_sense(void) FASTCODE;
 int key_check(int keynum);
 int key_read(int keynum);
 
@@ -45,12 +50,13 @@ void key_init(void)
                      /* PA4-6 はLCD制御(E,R/W,RS)の出力用 */
   P6DDR = 0;         /* P60-2 はキーボードマトリクスの入力用 */
                      /* P63-6 はCPUのバス制御として固定(モード6の時) */
-  keybufdp = 0;
   /* キーバッファのクリア */
+  ring_init(&keybuf);
   for (i = 0; i < KEYBUFSIZE; i++){
     for (j = 0; j < KEYROWNUM; j++){
-      keybuf[i][j] = 0x07; /* 何もキーが押されていない状態に初期化 */
+      ring_slot(&keybuf).row[j] = 0x07; /* 何もキーが押されていない状態に初期化 */
     }
+    ring_publish(&keybuf);
   }
   /* キー状態値のクリア */
   /* どのキーも押されていない状態に初期化 */
@@ -66,16 +72,14 @@ void key_sense(void)
   int row;
   unsigned char r;
 
-  /* リングバッファポインタ制御 */
-  keybufdp++;
-  if (keybufdp >= KEYBUFSIZE) keybufdp = 0;
   /* キースキャン */
   for(row = 0; row < KEYROWNUM; row++){ /* 列ごとにスキャン */
     r = ~(1 << row) & 0x0f;  /* スキャンする列のビットだけ 0 にする */
     r = r | (PADR & 0x70);   /*  LCD の制御に影響しないための対策 */
     PADR = r;                /*  キーデータの読み込み (0:ON, 1:OFF) */
-    keybuf[keybufdp][row] = P6DR & 0x03; /* キーバッファに格納 */
+    ring_slot(&keybuf).row[row] = P6DR & 0x03; /* キーバッファに格納 */
   }
+  ring_publish(&keybuf);     /* 全ての列を書き終えてから読めるようにする */
 }
 
 int key_check(int keynum)
@@ -86,8 +90,9 @@ int key_check(int keynum)
      /* 戻り値は, KEYOFF, KEYON, KEYTRANS, KEYNONE のいずれか              */
      /* チェック中の割り込みによるバッファ書き換え対策はバッファの大きさで対応 */
 {
-  int bitpos,row,r,i,dp;
-  int kbdp,count_swon,count_swoff;
+  int bitpos,row,r,i;
+  unsigned short kbdp;
+  int count_swon,count_swoff;
   unsigned char bitmask,keydata;
 
   if ((keynum < KEYMINNUM) || (keynum > KEYMAXNUM))
@@ -98,13 +103,11 @@ int key_check(int keynum)
     bitmask = 1 << bitpos;       /* ビット位置にマスクを設定 */
     row = (keynum - bitpos) / KEYCOLNUM;
     row = KEYROWNUM - 1 - row;   /* キーの配置されている列位置 */
-    kbdp = keybufdp;             /* キーバッファポインタを覚えておく */
+    kbdp = ring_head(&keybuf);   /* キーバッファの書き込み数を覚えておく */
     count_swoff = count_swon = 0;    /* 連続数カウンタの初期化 */
     /* 指定された長さ分だけキーの状態を調べる */
     for (i = 0; i < KEYCHKCOUNT; i++){
-      dp = kbdp - i;
-      if (dp < 0) dp = dp + KEYBUFSIZE; /* キーバッファポインタの範囲チェック */
-      keydata = keybuf[dp][row];        /* バッファからデータを取り出す */
+      keydata = ring_at(&keybuf, kbdp, i).row[row]; /* i 回前のスキャン */
       /* バッファから状態を調べる (キーは押されると 0 になることに注意) */
       if ((keydata & bitmask) != 0) count_swoff++;  /* 押されていない */
       else count_swon++;                            /* 押されている   */
@@ -1,7 +1,7 @@
 // key.c を利用するために必要なヘッダファイル
 // 外から参照される関数や定数を宣言
 
-#define KEYBUFSIZE 10  /* キーバッファの大きさ */
+#define KEYBUFSIZE  8  /* キーバッファの大きさ (2のべき乗, ring.h) */
 #define KEYCHKCOUNT 5  /* キーの連続状態を調べるバッファ上の長さ　 */
                          /* ↑キーバッファの大きさよりも小さくすること */
                          /*   余裕が少ないと正しく読めないことがある */
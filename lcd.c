@@ -1,68 +1,139 @@
 #include <string.h>
 #include "h8-3069-iodef.h"
+#include "fastram.h"
+#include "lcd.h"
 
 #define TIMECONST 500
-#define TCONST40us 800
 #define TCONST1ms 5000
 #define LCD_RS 0x40
 #define LCD_RW 0x20
 #define LCD_E 0x10
+#define LCD_SETADR 0x80  /* DDRAMアドレスセットのコマンド */
 
-void lcd_init(void);
+/* フレームバッファ (メインループが書き, lcd_flush() が読む)  */
+/*   lcd_shown は LCD に送った文字 (lcd_flush() だけが書く)   */
+static volatile unsigned char lcd_fb[LCD_ROWS][LCD_COLS] FASTDATA;
+static unsigned char lcd_shown[LCD_ROWS][LCD_COLS] FASTDATA;
+/* 各行の先頭の DDRAM アドレス (3, 4行目は SC2004C, L2034 などの4行LCD) */
+static const unsigned char lcd_rowadr[4] FASTCONST = { 0x00, 0x40, 0x14, 0x54 };
+
+/* 書き込む位置 (メインループ) */
+static int lcd_x, lcd_y;
+/* フレームバッファを書き換えた回数 (書き換えてから進める)     */
+/* lcd_flush() は全ての文字を送り終えたときの値を lcd_idle に残し, */
+/* 次に書き換えられるまで調べない                              */
+static volatile unsigned char lcd_gen FASTDATA;
+static unsigned char lcd_idle FASTDATA;
+/* lcd_flush() が次に調べる位置と, LCD の今のアドレス */
+static unsigned char lcd_fx FASTDATA, lcd_fy FASTDATA;
+static unsigned char lcd_adr FASTDATA;
+
+/* 電源投入後の初期化の手順 (lcd_flush() が1回に1つずつ送る) */
+/*   wait : 送った後に待つ時間[ms] (0 なら次の呼び出しで送る) */
+struct lcd_boot {
+  unsigned char cmd;
+  unsigned char wait;
+};
+static const struct lcd_boot lcd_boot_seq[] FASTCONST = {
+  { 0x3f,   5 },     /* データ転送幅(8ビット) */
+  { 0x3f, 100 },
+  { 0x3f,   0 },
+  { 0x3f,   0 },     /* データ転送幅8ビット, 2ライン, 5x10ドット */
+  { 0x04,   0 },     /* ディスプレイON/OFF制御(OFF) */
+  { 0x01,   2 },     /* ディスプレイ全クリア (処理待ち > 1.64ms) */
+  { 0x06,   0 },     /* エントリーモードセット Inc. without Disp.shift */
+  { 0x0c,   0 },     /* ディスプレイON/OFF制御(ON) */
+  { LCD_SETADR, 0 }  /* DDRAMアドレスセット */
+};
+#define LCD_BOOTNUM (sizeof(lcd_boot_seq) / sizeof(lcd_boot_seq[0]))
+/* 電源投入から最初のコマンドまで待つ時間[ms] */
+#define LCD_POWERUP 15
+
+/* 初期化の手順の次の番号 (LCD_BOOTNUM なら初期化済み) と,     */
+/* 次に送るまでの lcd_flush() の呼び出しの回数                */
+/* 待ち時間は lcd_init() で呼び出しの回数に直しておく (除算なし) */
+static unsigned char lcd_step FASTDATA;
+static unsigned short lcd_wait FASTDATA;
+static unsigned short lcd_boot_wait[LCD_BOOTNUM] FASTDATA;
+
+void lcd_init(unsigned int tick_us);
 void lcd_cursor(int x, int y);
 void lcd_clear(void);
 void lcd_printstr(unsigned char *str);
 void lcd_printch(unsigned char ch);
-void lcd_putch(unsigned char ch, unsigned char rs);
+void lcd_flush(void) FASTCODE;
+int lcd_ready(void);
+static unsigned short lcd_ticks(unsigned int ms, unsigned int tick_us);
+static void lcd_write(unsigned char ch, unsigned char rs) FASTCODE;
 void wait1ms(int ms);
 
-void lcd_init(void)
+static unsigned short lcd_ticks(unsigned int ms, unsigned int tick_us)
+     /* ms[ms] 以上待つために送らずに戻る lcd_flush() の呼び出しの回数 */
+     /* を返す関数. 切り上げるので, 呼び出しの間隔が揺れても足りる     */
+{
+  return ((unsigned long)ms * 1000 + tick_us - 1) / tick_us;
+}
+
+void lcd_init(unsigned int tick_us)
      /* LCD 表示器を使うための初期化関数             */
      /* 一部, キーセンスとの兼ね合いがあるが対策済み */
-     /* LCD 表示器の初期化には時間がかかるので注意   */
+     /* ポートとフレームバッファを初期化するだけで待たない           */
+     /* LCD の初期化の手順は, tick_us[us] ごとに呼ばれる lcd_flush()  */
+     /* が進める (電源投入から約130ms, lcd_ready() で分かる)          */
+     /* その間もフレームバッファには書けて, 終わると表示される       */
 {
-  wait1ms(15);
+  int n, x, y;
+
   PADR = 0x0f;       /* PA0-3 は0アクティブ, PA4-6 は1アクティブ */
   PADDR = 0x7f;      /* PA4-6 は出力に設定(LCD制御 E,R/W,RS) */
                      /* PA0-3 はキーボードマトリクスの出力用 */
   P4DR = 0;          /* LCD データ */
   P4DDR = 0xff;      /* P40-7 全て出力に設定(LCD DB0-7) */
-  lcd_putch(0x3f,0); /* データ転送幅(8ビット) */
-  wait1ms(5);
-  lcd_putch(0x3f,0);
-  wait1ms(100);
-  lcd_putch(0x3f,0);
-  lcd_putch(0x3f,0); /* データ転送幅8ビット, 2ライン, 5x10ドット */
-  lcd_putch(0x04,0); /* ディスプレイON/OFF制御(OFF) */
-  lcd_putch(0x01,0); /* ディスプレイ全クリア */
-  wait1ms(2);        /* 処理待ち > 1.64ms */
-  lcd_putch(0x06,0); /* エントリーモードセット Inc. without Disp.shift */
-  lcd_putch(0x0c,0); /* ディスプレイON/OFF制御(ON) */
-  lcd_putch(0x80,0); /* DDRAMアドレスセット */
+  for (n = 0; n < LCD_BOOTNUM; n++) {
+    lcd_boot_wait[n] = lcd_ticks(lcd_boot_seq[n].wait, tick_us);
+  }
+  lcd_wait = lcd_ticks(LCD_POWERUP, tick_us);
+  lcd_step = 0;
+
+  /* フレームバッファは初期化後の表示と同じく空白で, 送るものはない */
+  for (y = 0; y < LCD_ROWS; y++) {
+    for (x = 0; x < LCD_COLS; x++) lcd_fb[y][x] = lcd_shown[y][x] = ' ';
+  }
+  lcd_x = lcd_y = 0;
+  lcd_fx = lcd_fy = 0;
+  lcd_adr = 0;       /* 初期化の最後のアドレスセットの後 */
+  lcd_idle = lcd_gen;
+}
+
+int lcd_ready(void)
+     /* LCD の初期化が終わっていれば 1 を返す関数 */
+{
+  return lcd_step == LCD_BOOTNUM;
 }
 
 void lcd_cursor(int x, int y)
      /* 表示位置を変更する関数 */
      /* 表示器左上が (0,0) となる */
+     /* 表示器の外の位置は無視する (位置は変わらない) */
 {
-  char adr;
-
-  if ((x < 16) && (y < 4)) {
-    switch (y) {
-    case 1: adr = 0xc0; break; /* 2行目の先頭 */
-    case 2: adr = 0x94; break; /* 4桁LCD(SC2004C, L2034)などの3行目の先頭 */
-    case 3: adr = 0xd4; break; /* 4桁LCD(SC2004C, L2034)などの4行目の先頭 */
-    default: adr = 0x80;       /* 1行目の先頭 */
-    }
-    lcd_putch(adr+x,0);
+  if ((x >= 0) && (x < LCD_COLS) && (y >= 0) && (y < LCD_ROWS)) {
+    lcd_x = x;
+    lcd_y = y;
   }
 }
 
 void lcd_clear(void)
      /* 表示器の全画面をクリアするための関数 */
+     /* フレームバッファを空白にするだけで待たない. 表示位置は (0,0) */
+     /* 続けて同じ文字を書き直したところは LCD に送られない          */
 {
-  lcd_putch(0x01,0); /* ディスプレイ全クリア */
-  wait1ms(2);        /* 処理待ち > 1.64ms */
+  int x, y;
+
+  for (y = 0; y < LCD_ROWS; y++) {
+    for (x = 0; x < LCD_COLS; x++) lcd_fb[y][x] = ' ';
+  }
+  lcd_x = lcd_y = 0;
+  lcd_gen++;
 }
 
 void lcd_printstr(unsigned char *str)
@@ -78,17 +149,76 @@ void lcd_printstr(unsigned char *str)
 void lcd_printch(unsigned char ch)
      /* 表示器に1文字だけ表示する関数 */
      /* 文字コードは ASCII コードの範囲なら問題ない */
+     /* フレームバッファに書いて表示位置を右に進める (行の右端を越えた */
+     /* 文字は表示されない). LCD には lcd_flush() が後で送る           */
+{
+  if (lcd_x >= LCD_COLS) return;
+  if (lcd_fb[lcd_y][lcd_x] != ch) {
+    lcd_fb[lcd_y][lcd_x] = ch;
+    lcd_gen++;           /* 書いてから進める */
+  }
+  lcd_x++;
+}
+
+void lcd_flush(void)
+     /* フレームバッファの変わった文字を LCD に送る関数             */
+     /* タイマ割り込みから lcd_init() に渡した間隔で呼ぶ            */
+     /* (40us 以上の間隔なので処理待ちはしない)                     */
+     /* 1回に1つだけ, アドレスセットか文字を転送する. 前に調べた位置 */
+     /* から順に探すので, 続いている文字は LCD のアドレスの自動     */
+     /* インクリメントでアドレスセットなしに送られる                */
+     /* LCD の初期化が終わるまでは, 初期化の手順を待ち時間をおいて  */
+     /* 1つずつ送る                                                 */
 {
-  lcd_putch(ch,1);  /* キャラクタを1文字転送 */
+  int n, x, y;
+  unsigned char gen, adr, c;
+
+  if (lcd_step < LCD_BOOTNUM) {
+    if (lcd_wait != 0) {
+      lcd_wait--;
+      return;
+    }
+    lcd_write(lcd_boot_seq[lcd_step].cmd, 0);
+    lcd_wait = lcd_boot_wait[lcd_step];
+    lcd_step++;
+    return;
+  }
+
+  gen = lcd_gen;
+  if (gen == lcd_idle) return;
+
+  x = lcd_fx;
+  y = lcd_fy;
+  for (n = 0; n < LCD_ROWS * LCD_COLS; n++) {
+    if (lcd_fb[y][x] != lcd_shown[y][x]) break;
+    if (++x >= LCD_COLS) {
+      x = 0;
+      if (++y >= LCD_ROWS) y = 0;
+    }
+  }
+  lcd_fx = x;
+  lcd_fy = y;
+  if (n == LCD_ROWS * LCD_COLS) {  /* 全て送り終えている */
+    lcd_idle = gen;
+    return;
+  }
+
+  adr = lcd_rowadr[y] + x;
+  if (adr != lcd_adr) {
+    lcd_write(LCD_SETADR | adr, 0);
+    lcd_adr = adr;
+    return;
+  }
+  c = lcd_fb[y][x];     /* 送った後で書き換えられたら次に送り直す */
+  lcd_write(c, 1);
+  lcd_shown[y][x] = c;
+  lcd_adr++;            /* LCD のアドレスは自動インクリメント */
 }
 
-void lcd_putch(unsigned char ch, unsigned char rs)
-     /* LCD にコマンドやデータを送るための関数   */
-     /* ch にコマンドまたはデータを入れる        */
-     /* rs が 0 のときコマンド, 1 のときはデータ */
-     /* 通常, ユーザから直接呼び出すことはない   */
+static void lcd_write(unsigned char ch, unsigned char rs)
+     /* LCD にコマンドやデータを送る関数 (処理待ちはしない) */
+     /* rs が 0 のときコマンド, 1 のときはデータ            */
 {
-  int i;
   unsigned char st13,st2,key;
 
   rs = rs << 6;
@@ -101,7 +231,6 @@ void lcd_putch(unsigned char ch, unsigned char rs)
   PADR = st2;       /* E信号を 1 にする */
   P4DR = ch;        /* データまたはコマンドを送る */
   PADR = st13;      /* E信号を 0 にする */
-  for (i = 0; i < TCONST40us; i++); /* 40us 待ち(LCDの処理時間) */
 }
 
 void wait1ms(int ms)
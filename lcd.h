@@ -1,6 +1,25 @@
-extern void lcd_init(void);
+// lcd.c を利用するために必要なヘッダファイル
+// 表示はフレームバッファ(LCD_ROWS 行 x LCD_COLS 桁)に書くだけで待たない
+// 変わった文字は lcd_flush() がタイマ割り込みで1回に1つずつ LCD に送る
+// LCD の電源投入後の初期化の手順も lcd_flush() が待ち時間をおいて送るので,
+// lcd_init() はすぐに戻り, 制御は LCD の初期化を待たずに始められる
+
+#define LCD_ROWS 2     /* 行数 (4行LCD なら 4) */
+#define LCD_COLS 16    /* 1行の桁数 (20桁LCD なら 20) */
+
+extern void lcd_init(unsigned int tick_us);
+     /* ポートとフレームバッファを初期化する (待たない)                 */
+     /* tick_us : lcd_flush() を呼ぶ間隔[us] (初期化の待ち時間に使う)    */
+extern int lcd_ready(void);
+     /* LCD の初期化が終わっていれば 1 (それまでの表示は終わってから出る) */
 extern void lcd_cursor(int x, int y);
+     /* 次に書く位置を (x,y) にする (左上が (0,0)) */
 extern void lcd_clear(void);
+     /* 全画面を空白にし, 位置を (0,0) にする */
 extern void lcd_printstr(unsigned char *str);
 extern void lcd_printch(unsigned char ch);
+     /* 今の位置に書いて位置を右に進める */
+extern void lcd_flush(void);
+     /* LCD の初期化を進めるか, 変わった文字を1つ送る                   */
+     /* タイマ割り込みから tick_us ごとに呼ぶ (40us 以上の間隔であること) */
 extern void wait1ms(int ms);
@@ -1,354 +1,451 @@
+#include <stddef.h>
 #include "h8-3069-iodef.h"
-#include "h8-3069-int.h"
+#include "intr.h"
 
 #include "lcd.h"
 #include "ad.h"
 #include "timer.h"
 #include "key.h"
+#include "motor.h"
+#include "filter.h"
+#include "pid.h"
+#include "estimator.h"
+#include "sensor.h"
+#include "trace.h"
+#include "hist.h"
+#include "profile.h"
+#include "sched.h"
+#include "fastram.h"
+#include "ring.h"
+#include "seqlock.h"
+#include "menu.h"
 
 /* タイマ割り込みの時間間隔[μs] */
 #define TIMER0 1000
 
-/* 割り込み処理で各処理を行う頻度を決める定数 */
+/* 割り込み処理で各処理を行う頻度と位相を決める定数 [割り込みの回数] */
+/* 位相は 0 - (頻度-1) で, 同じ頻度の処理は位相をずらすと負荷が分散する */
 #define DISPTIME 100
+#define DISPPHASE 0
+/* 計測結果を SCI2 に送信する間隔[表示の回数] (PROFILE のときのみ) */
+#define PROFREPORTTIME 10
 #define KEYTIME 1
+#define KEYPHASE 0
 #define ADTIME  1
-#define PWMTIME 1
+#define ADPHASE 0
 #define CONTROLTIME 1
+#define CONTROLPHASE 0
+/* LCD に1文字送る頻度 (LCD の処理時間 40us より長ければ良い) */
+#define LCDTIME 1
+#define LCDPHASE 0
 
-/* LED関係 */
-/* LEDがPBに接続されているビット位置 */
-#define LMOTOR_IN1   0x01
-#define LMOTOR_IN2   0x02
-#define RMOTOR_IN1   0x04
-#define RMOTOR_IN2   0x08
-
-/* LCD表示関連 */
-/* 1段に表示できる文字数 */
-#define LCDDISPSIZE 10
-
-/* PWM制御関連 */
-/* 制御周期を決める定数 */
-#define MAXPWMCOUNT 255
+/* 起動の各段階の時刻を記録する番号 (boot_time[]) */
+#define BOOT_INTRINIT 0  /* 初期化が終わった (割り込みを許可する直前) */
+#define BOOT_CONTROL  1  /* 最初の control_proc() */
+#define BOOT_LCD      2  /* LCD の初期化が終わった (lcd_ready()) */
+#define BOOT_NUM      3
 
 /* A/D変換関連 */
-/* A/D変換のチャネル数とバッファサイズ */
+/* A/D変換のチャネル数(AN0 から) */
+/* 変換結果は DMAC が ad.c のリングバッファ ad_dmabuf に転送する */
 #define ADCHNUM   3
-#define ADBUFSIZE 8
-/* 平均化するときのデータ個数 */
-#define ADAVRNUM 4
+/* 平均化するときのデータ個数 (2^ADAVRSHIFT 個, filter.c の shift) */
+/* PWM に同期して変換するとき(ADSYNC)はスイッチングの雑音が揃うので少なくて良い */
+#ifdef ADSYNC
+#define ADAVRSHIFT 1
+#else
+#define ADAVRSHIFT 2
+#endif
+/* ADSYNC のときに読むスキャンの PWM の周期の中の位置 (0-3, 1/4 周期単位) */
+/*   3 : AN1, AN2 を周期の約 81%, 88% の位置で変換する                    */
+/*       (デューティ 80% 以下ならモータの出力がオフの期間になる)          */
+#define ADSYNCPHASE 3
 /* チャネル指定エラー時に返す値 */
 #define ADCHNONE -1
 
-#define SENSOR_BUFFER_SIZE 10
-
-#define MOTOR_MAXSPEED 255
+/* センサの値を残す個数 (2のべき乗, ring.h) */
+#define SENSOR_BUFFER_SIZE 16
+
+#define MOTOR_MAXSPEED MOTOR_PWMMAX
+
+/* ステアリングの方式 */
+#define STEER_BANGBANG 0   /* 白黒の判定で片方の車輪を減速する */
+#define STEER_PID      1   /* ラインの位置を PID 制御する */
+
+/* PID のゲインの初期値と上限 (pid.h の PID_SHIFT の固定小数点, 8 = 1.0) */
+#define STEER_KP  8
+#define STEER_KI  0
+#define STEER_KD  16
+#define STEER_GAINMAX 31
+
+/* センサアレイの設定表 (sensor.c)                                  */
+/*   チャネルと位置[1/8 mm] (AN1 側が正, ロボットの中心線が 0)       */
+/*   センサを増やすときはここに行を足し, ADCHNUM をそのチャネルまで増やす */
+#define SENSOR_NUM 2
+static const unsigned char sensor_ch[SENSOR_NUM] FASTCONST = { 1, 2 };
+static const short sensor_pos[SENSOR_NUM] FASTCONST = { 120, -120 };
+/* 一番外側のセンサの位置 (片側が真っ黒のときのラインの位置) */
+#define SENSOR_POSMAX 120
+/* 白黒の判定(STEER_BANGBANG)に使う2個のセンサ (設定表の番号) */
+#define SENSOR_L 0           /* sensor_l (AN1) */
+#define SENSOR_R 1           /* sensor_r (AN2) */
+
+/* ライン位置の推定器のゲイン (estimator.h の EST_SHIFT の固定小数点, 256 = 1.0) */
+#define STEER_EST_ALPHA 128
+#define STEER_EST_BETA  32
+
+/* STEER_PID の測定値の換算 (x 1/256)                                    */
+/*   PID と推定器のゲインは, 左右のセンサの黒さを A/D の値(校正の白黒の  */
+/*   1/4 からの差, 片側が真っ黒で 126)で測ったときに合わせてある.         */
+/*   重心の位置は片側が真っ黒で SENSOR_POSMAX なので, 126/120 倍して同じ  */
+/*   大きさにする (換算しないとループゲインが 5% 下がり, 小さいゲインで    */
+/*   ラインを見失う)                                                     */
+#define STEER_YSCALE 269
+#define STEER_YMAX ((SENSOR_POSMAX * STEER_YSCALE) >> 8) /* 片側が真っ黒のときの測定値 */
 
 #define JUMPMODE_JUMP      0
 #define JUMPMODE_TURNRIGHT 1
 #define JUMPMODE_TURNLEFT  2
 
 /* 割り込み処理に必要な変数は大域変数にとる */
-volatile int disp_time, key_time, ad_time, pwm_time, control_time;
+/* 割り込み処理で読み書きする変数は内蔵RAMに置く (fastram.h) */
 
 /* LED関係 */
-volatile static char sensor_r[SENSOR_BUFFER_SIZE];
-volatile static int sensor_r_dp = 0;
-volatile static char sensor_l[SENSOR_BUFFER_SIZE];
-volatile static int sensor_l_dp = 0;
+/* センサの値は A/D変換の10ビット(0-ADMAX)のまま扱う */
+/* control_proc() が左右を同じ周期の組にして書き, メインループが最新を読む */
+struct sensor_pair {
+  unsigned short r, l;
+};
+static RING(struct sensor_pair, SENSOR_BUFFER_SIZE) sensor_buf FASTDATA;
 
 /* LCD関係 */
-volatile int disp_flag;
-//volatile char lcd_str_upper[LCDDISPSIZE+1];
-//volatile char lcd_str_lower[LCDDISPSIZE+1];
+volatile unsigned char disp_flag FASTDATA;
 
-/* モータ制御関係 */
-volatile int pwm_count;
+/* 起動の各段階の時刻 [タイマ0を動かしてからの us] (0 ならまだ)     */
+/*   リセットからの時間は, タイマ0を動かすまでの初期化の時間を足す */
+/*   (sim/iss.c はリセットから main(), control_proc() までも表示する) */
+volatile unsigned long boot_time[BOOT_NUM] FASTDATA;
 
 /* A/D変換関係 */
-volatile unsigned char adbuf[ADCHNUM][ADBUFSIZE];
-volatile int adbufdp;
-
-volatile int global_state;
-
-volatile int motorspeed_r;
-volatile int motorspeed_l;
-volatile int motordirection_r;
-volatile int motordirection_l;
+/* ADTIME ごとに読み出した最新のスキャン */
+struct ad_sample ad_now FASTDATA;
+/* チャネルごとのフィルタ (ad_read() はこの出力を返す) */
+struct filter adfilter[ADCHNUM] FASTDATA;
+/* チャネルごとのフィルタの種類 (実行中に filter_init() で変えても良い) */
+static const unsigned char adfilter_type[ADCHNUM] = {
+  FILTER_NONE,   /* AN0: 未使用 */
+  FILTER_AVR,    /* AN1: センサ */
+  FILTER_AVR     /* AN2: センサ */
+};
+
+/* 制御の設定 (メインループと sim/ が書き換え, control_proc() は */
+/* 1周期の初めに1回だけ読む)                                     */
+/*   H8 のデータバスは16ビットなので, 16ビット以下なら1回で読み書きできる */
+volatile unsigned char global_state FASTDATA;
+
+/* モータへの指令 (control_proc() が1周期に1回まとめて書き換える) */
+/* メインループは表示に使うだけなので, 読み出しは16ビットずつで良い */
+struct motor_cmd motor_now FASTDATA;
 
 #define STATE_STOP        0
 #define STATE_LINETRACE   1
 
-volatile int sensor_limit;
-
-//volatile int sensor_state_r;
-//volatile int sensor_state_l;
+volatile short sensor_limit FASTDATA;
 
-volatile int jumpmode = JUMPMODE_JUMP;
+volatile unsigned char jumpmode FASTDATA = JUMPMODE_JUMP;
 
 
+/* メニューの画面 (menu_page[] の順) */
 #define MENU_SETKP          0
 #define MENU_SETBLACK       1
 #define MENU_SETWHITE       2
 #define MENU_SETJUMPMODE    3
 #define MENU_SETSTOP        4
 #define MENU_STATUS         5
-
-volatile int menumode = MENU_SETSTOP;
-
-volatile static int sensor_limit_1 = 0x6c;
-volatile static int sensor_limit_2 = 0x57;
-
-volatile int target;
-volatile int kp = 8;
+#define MENU_LOAD           6
+
+volatile static short sensor_limit_1 = 0x360;
+volatile static short sensor_limit_2 = 0x2b8;
+
+volatile unsigned char kp FASTDATA = 8;
+
+volatile unsigned char steermode FASTDATA = STEER_BANGBANG;
+struct pid steer_pid FASTDATA;    /* STEER_PID のときの制御器 (ゲインは MENU_SETKP で変更) */
+struct est steer_est FASTDATA;    /* steer_y から求めたラインの位置と速さの推定 */
+struct sensor_array sensors FASTDATA; /* センサアレイ (control_proc() で更新) */
+struct trace trace_sm FASTDATA;   /* ライントレースの状態 (MENU_STATUS に表示) */
+
+/* メニューで変える設定                                                  */
+/*   メインループは上の制御の変数を直接書かず, 変えた組を ctl_post() で  */
+/*   ctl_stage に書く. control_proc() が周期の初めに ctl_apply() で      */
+/*   まとめて反映するので, 1周期の中で新旧の設定が混ざることはない       */
+struct ctl_param {
+  short limit;                 /* sensor_limit */
+  unsigned char state;         /* global_state */
+  unsigned char kp;            /* kp */
+  unsigned char jump;          /* jumpmode */
+  unsigned char steer;         /* steermode */
+  unsigned char pid_kp, pid_ki, pid_kd; /* steer_pid のゲイン (0-STEER_GAINMAX) */
+  unsigned short zero[SENSOR_NUM];     /* センサの校正 (sensors の zero, gain) */
+  unsigned short gain[SENSOR_NUM];
+};
+static struct ctl_param ctl_stage FASTDATA;
+static struct seqlock ctl_stage_lock FASTDATA;
+static unsigned short ctl_stage_seen FASTDATA; /* 反映した ctl_stage_lock.seq */
+
+/* 割り込み処理からメインループに渡す状態                            */
+/*   control_proc() が周期の終わりに ctl_publish() で書き, メインループ */
+/*   は seq_read() で同じ周期の組を読む (割り込みは禁止しない)         */
+struct ctl_view {
+  struct sensor_pair sensor;   /* 最新のセンサの値 */
+  unsigned short raw[SENSOR_NUM]; /* 最新のセンサアレイの A/D の値 */
+  struct motor_cmd motor;      /* モータへの指令 */
+  unsigned char trace;         /* ライントレースの状態 (trace.h) */
+  struct ctl_param param;      /* 制御に使っている設定 */
+};
+static struct ctl_view ctl_view FASTDATA;
+static struct seqlock ctl_view_lock FASTDATA;
+
+/* メニューが表示する状態と変える設定 (メインループだけが使う) */
+static struct ctl_view disp_view;
+static struct ctl_param disp_param;
+/* 校正の計算に使うセンサアレイ (白と黒のレベルはここにだけある)      */
+/*   除算を使う sensor_cal_*() はこちらで行い, 求めた zero, gain を    */
+/*   ctl_post() で送る. 制御の sensors は ctl_apply() で書き換えるだけ */
+static struct sensor_array cal_sensors;
+#ifndef PROFILE
+/* MENU_STATUS 画面に表示する割り込みの最大の負荷[%]と周期を越えた回数 */
+static int disp_load, disp_over;
+#endif
+/* MENU_LOAD 画面に表示する処理(sched_table[] の行)と, その最大の */
+/* 実行時間[周期に対する %]と予算を越えた回数                       */
+static int disp_task, disp_task_max, disp_task_over;
+static struct menu menu;
+
+#ifdef PROFILE
+/* MENU_STATUS 画面に表示する計測の段 */
+volatile int prof_disp = PROF_IMIA0;
+volatile int prof_report_time = 0;
+#endif
 
 
 int main(void);
-void int_imia0(void);
-void int_adi(void);
-int  ad_read(int ch);
-void pwm_proc(void);
-void control_proc(void);
+void int_imia0(void) FASTCODE;
+void ad_filter(void) FASTCODE;
+int  ad_read(int ch) FASTCODE;
+void control_proc(void) FASTCODE;
+void steer_pid_proc(int y, struct motor_cmd *m) FASTCODE;
+void disp_tick(void) FASTCODE;
+static void ctl_post(const struct ctl_param *p);
+static void ctl_apply(void) FASTCODE;
+static void ctl_publish(void) FASTCODE;
+static void menu_cal(int white);
+static int menu_cal_black(void);
+static int menu_cal_white(void);
+static void menu_status(void);
+static int menu_status_reset(void);
+#ifdef PROFILE
+static int menu_prof_next(void);
+#endif
+static void menu_load(void);
+static int menu_load_next(void);
+static int menu_load_reset(void);
+
+/* タイマ割り込みで呼び出す処理の表 (sched.c)                      */
+/*   同じ割り込みで呼ぶ処理は表の順 (A/D の読み出しは制御より前)   */
+/*   予算[us]を越えた回数を数える. 周期的な処理はここに行を足す     */
+static const struct sched_task sched_table[] FASTCONST = {
+  /* 関数         頻度         位相          予算  計測の段(PROFILE) */
+  { disp_tick,    DISPTIME,    DISPPHASE,      10, PROF_NONE },
+  { key_sense,    KEYTIME,     KEYPHASE,      100, PROF_KEY },
+  { ad_filter,    ADTIME,      ADPHASE,        50, PROF_AD },
+  { control_proc, CONTROLTIME, CONTROLPHASE,  500, PROF_CONTROL },
+  { lcd_flush,    LCDTIME,     LCDPHASE,       20, PROF_NONE }
+};
+#define SCHED_NUM (sizeof(sched_table) / sizeof(sched_table[0]))
+
+/* 割り込みの優先順位 (intr.c, 表にない要因は優先順位 0)                */
+/*   ハンドラのある要因だけを書く. 今のハンドラは int_imia0 だけ          */
+/*   A/D変換の結果は DMAC が転送し(DTIE=0), PWM は8ビットタイマが出力   */
+/*   するので, A/D とモータの更新は CPU の割り込みを待たない            */
+/*   短くて遅れが許されないハンドラを足すときは, その要因を INTR_HIGH   */
+/*   で書けば, int_imia0 の制御の実行中でも入れ子で受け付けられる        */
+static const struct intr_prio intr_table[] = {
+  { INTR_ITU0, INTR_LOW }    /* 制御周期 (sched.c) */
+};
+#define INTR_NUM (sizeof(intr_table) / sizeof(intr_table[0]))
+
+/* メニューの画面 (menu.c)                                          */
+/*   キー1で次の画面, キー3で欄を選び, キー2で選んだ欄を増やす       */
+/*   (上限を越えると 0). キーの関数を書いた画面ではその関数を呼ぶ    */
+/*   欄は変数の値が変わったときだけ表示し直される                   */
+static const char *const menu_kp_title[] = { " KP" };
+static const char *const menu_pid_title[] = { " PID" };
+static const char *const menu_kp_label[] = { "KP=" };
+static const char *const menu_mode_label[] = { "MODE=" };
+static const char *const menu_steer_names[] = { "BANG", "PID " }; /* STEER_xxx */
+static const char *const menu_jump_names[] = { "J", "R", "L" };   /* JUMPMODE_xxx */
+static const char *const menu_state_names[] = { "STOP0", "LINE1" }; /* STATE_xxx */
+static const char *const menu_task_label[] = { "T" };
+static const char *const menu_hist_label[] = { "H" };
+
+static const struct menu_field menu_setkp[] = {
+  /* 型         x  y 名前 変数                                最大           印         文字列            関数  表示の条件 */
+  { MENU_LABEL, 3, 0, 0,  NULL, 0,                              0,             0,         menu_kp_title,    NULL, &disp_param.steer, STEER_BANGBANG },
+  { MENU_LABEL, 3, 0, 0,  NULL, 0,                              0,             0,         menu_pid_title,   NULL, &disp_param.steer, STEER_PID },
+  { MENU_LABEL, 0, 1, 0,  NULL, 0,                              0,             0,         menu_kp_label,    NULL, &disp_param.steer, STEER_BANGBANG },
+  { MENU_DIGIT, 3, 1, 0,  MENU_VAR(disp_param.kp),              9,             0,         NULL,             NULL, &disp_param.steer, STEER_BANGBANG },
+  { MENU_DEC2,  1, 1, 'P', MENU_VAR(disp_param.pid_kp),         STEER_GAINMAX, MENU_MARK, NULL,             NULL, &disp_param.steer, STEER_PID },
+  { MENU_DEC2,  5, 1, 'I', MENU_VAR(disp_param.pid_ki),         STEER_GAINMAX, MENU_MARK, NULL,             NULL, &disp_param.steer, STEER_PID },
+  { MENU_DEC2,  9, 1, 'D', MENU_VAR(disp_param.pid_kd),         STEER_GAINMAX, MENU_MARK, NULL,             NULL, &disp_param.steer, STEER_PID },
+  { MENU_ENUM, 10, 0, 0,  MENU_VAR(disp_param.steer),           1,             MENU_MARK, menu_steer_names, NULL, NULL, 0 }
+};
+static const struct menu_field menu_setblack[] = {
+  { MENU_HEX3,  0, 1, 0,  MENU_VAR(sensor_limit_1),             0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_HEX3,  4, 1, 0,  MENU_VAR(disp_view.sensor.r),         0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_HEX3,  8, 1, 0,  MENU_VAR(disp_view.sensor.l),         0,             0,         NULL,             NULL, NULL, 0 }
+};
+static const struct menu_field menu_setwhite[] = {
+  { MENU_HEX3,  0, 1, 0,  MENU_VAR(sensor_limit_2),             0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_HEX3,  4, 1, 0,  MENU_VAR(disp_view.sensor.r),         0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_HEX3,  8, 1, 0,  MENU_VAR(disp_view.sensor.l),         0,             0,         NULL,             NULL, NULL, 0 }
+};
+static const struct menu_field menu_setjump[] = {
+  { MENU_LABEL, 0, 1, 0,  NULL, 0,                              0,             0,         menu_mode_label,  NULL, NULL, 0 },
+  { MENU_ENUM,  5, 1, 0,  MENU_VAR(disp_param.jump),            2,             0,         menu_jump_names,  NULL, NULL, 0 }
+};
+static const struct menu_field menu_setstop[] = {
+  { MENU_ENUM,  0, 1, 0,  MENU_VAR(disp_param.state),           1,             0,         menu_state_names, NULL, NULL, 0 }
+};
+static const struct menu_field menu_stat[] = {
+  { MENU_DIGIT, 0, 0, 0,  MENU_VAR(disp_view.param.state),      0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_STR,   0, 1, 0,  MENU_VAR(disp_view.trace),            0,             0,         NULL,       trace_name, NULL, 0 },
+#ifndef PROFILE
+  { MENU_DEC2,  2, 0, 'L', MENU_VAR(disp_load),                 0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_DEC2,  6, 0, 'O', MENU_VAR(disp_over),                 0,             0,         NULL,             NULL, NULL, 0 },
+#endif
+  { MENU_HEX2,  3, 1, 0,  MENU_VAR(disp_view.motor.speed[MOTOR_R]), 0,         0,         NULL,             NULL, NULL, 0 },
+  { MENU_HEX2,  6, 1, 0,  MENU_VAR(disp_view.motor.speed[MOTOR_L]), 0,         0,         NULL,             NULL, NULL, 0 }
+};
+/* MENU_LOAD: 処理ごとの最大(M)と予算越え(O), 2行目は負荷のヒストグラム */
+/* (menu_load() が表示する)                                              */
+static const struct menu_field menu_sched[] = {
+  { MENU_LABEL, 5, 0, 0,  NULL, 0,                              0,             0,         menu_task_label,  NULL, NULL, 0 },
+  { MENU_DIGIT, 6, 0, 0,  MENU_VAR(disp_task),                  0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_DEC2,  8, 0, 'O', MENU_VAR(disp_task_over),            0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_DEC2, 12, 0, 'M', MENU_VAR(disp_task_max),             0,             0,         NULL,             NULL, NULL, 0 },
+  { MENU_LABEL, 0, 1, 0,  NULL, 0,                              0,             0,         menu_hist_label,  NULL, NULL, 0 }
+};
+#define MENU_FIELDS(f) (f), (sizeof(f) / sizeof((f)[0]))
+
+static const struct menu_page menu_page[] = {
+  /* 題名          欄                         キー2           キー3              毎回 */
+  { "SET",        MENU_FIELDS(menu_setkp),    NULL,           NULL,              NULL },
+  { "SETBLACK",   MENU_FIELDS(menu_setblack), menu_cal_black, NULL,              NULL },
+  { "SETWHITE&A", MENU_FIELDS(menu_setwhite), menu_cal_white, NULL,              NULL },
+  { "SET JUMP",   MENU_FIELDS(menu_setjump),  NULL,           NULL,              NULL },
+  { "SET STOP",   MENU_FIELDS(menu_setstop),  NULL,           NULL,              NULL },
+#ifdef PROFILE
+  { NULL,         MENU_FIELDS(menu_stat),     menu_prof_next, menu_status_reset, menu_status },
+#else
+  { NULL,         MENU_FIELDS(menu_stat),     NULL,           menu_status_reset, menu_status },
+#endif
+  { "LOAD",       MENU_FIELDS(menu_sched),    menu_load_next, menu_load_reset,   menu_load }
+};
+#define MENU_NUM (sizeof(menu_page) / sizeof(menu_page[0]))
 
 int main(void)
 {
+  int ch;
+
   /* 初期化 */
+  /* ROMエミュレーションはRAM化のときだけ (ベクタのある 0xffe000 の内蔵RAM */
+  /* を 0x000000 に見せる). ROM化(ON_ROM)で ON にすると, Flash-ROM の先頭  */
+  /* 4kB(ベクタと .text の先頭)が内蔵RAMに置き換わってしまう              */
+#ifndef ON_ROM
   ROMEMU();           /* ROMエミュレーションをON */
+#endif
 
   /* ここでmoterポート(PB)の初期化を行う */
   PBDDR = 0xff;
+  motor_init();        /* PB0-3 を8ビットタイマのPWM出力にする */
 
   /* 割り込みで使用する大域変数の初期化 */
-  pwm_time = pwm_count = 0;     /* PWM制御関連 */
-  disp_time = 0; disp_flag = 1; /* 表示関連 */
-  key_time = 0;                 /* キー入力関連 */
-  ad_time = 0;                  /* A/D変換関連 */
-  control_time = 0;             /* 制御関連 */
+  disp_flag = 1;       /* 表示関連 */
   /* ここまで */
-  adbufdp = 0;         /* A/D変換データバッファポインタの初期化 */
-  lcd_init();          /* LCD表示器の初期化 */
+  lcd_init(TIMER0 * LCDTIME); /* LCD表示器の初期化 (待たずに, lcd_flush() が進める) */
   //key_init();          /* キースキャンの初期化 */
+  trace_init(&trace_sm);
+  pid_init(&steer_pid, STEER_KP, STEER_KI, STEER_KD, MOTOR_MAXSPEED);
+  est_init(&steer_est, STEER_EST_ALPHA, STEER_EST_BETA, STEER_YMAX);
+  sensor_init(&sensors, SENSOR_NUM, sensor_ch, sensor_pos, sensor_limit_2, sensor_limit_1);
+  sensor_init(&cal_sensors, SENSOR_NUM, sensor_ch, sensor_pos, sensor_limit_2, sensor_limit_1);
   ad_init();           /* A/Dの初期化 */
+  for(ch = 0; ch < ADCHNUM; ch++){ /* A/D変換値のフィルタの初期化 */
+	  filter_init(&adfilter[ch], adfilter_type[ch], ADAVRSHIFT, 0);
+  }
+#ifdef ADSYNC
+  ad_sync_start(0,ADCHNUM,ADSYNCPHASE); /* PWM に同期してスキャンする */
+#else
+  ad_cont_start(0,ADCHNUM); /* AN0-2 を連続スキャンし, DMAC でバッファへ転送 */
+#endif
   timer_init();        /* タイマの初期化 */
   timer_set(0,TIMER0); /* タイマ0の時間間隔をセット */
+  sched_init(sched_table, SCHED_NUM, TIMER0); /* 割り込みで呼ぶ処理の表 */
   timer_start(0);      /* タイマ0スタート */
-  ENINT();             /* 全割り込み受付可 */
+#ifdef PROFILE
+  prof_init();         /* 割り込み処理の実行時間計測の初期化 */
+#endif
+  /* 割り込み処理と共有する変数は, 割り込みを許可する前に初期化する */
   global_state = STATE_STOP;
-  motorspeed_r = 0;
-  motorspeed_l = 0;
-  motordirection_r = 0;
-  motordirection_l = 0;
+  motor_now.speed[MOTOR_R] = 0;
+  motor_now.speed[MOTOR_L] = 0;
+  motor_now.dir[MOTOR_R] = MOTOR_FORWARD;
+  motor_now.dir[MOTOR_L] = MOTOR_FORWARD;
   int i;
 
+  ring_init(&sensor_buf);
   for(i = 0; i < SENSOR_BUFFER_SIZE ; i++){
-	  sensor_r[i] = 0;
-	  sensor_l[i] = 0;
+	  ring_slot(&sensor_buf).r = 0;
+	  ring_slot(&sensor_buf).l = 0;
+	  ring_publish(&sensor_buf);
   }
+  seq_init(&ctl_stage_lock);
+  ctl_stage_seen = 0;
+  seq_init(&ctl_view_lock);
+  ctl_publish();       /* 最初の周期の前でも読めるようにする */
+  intr_init(intr_table, INTR_NUM); /* 割り込みの優先順位, 入れ子の割り込み */
+  boot_time[BOOT_INTRINIT] = sched_time();
+  ENINT();             /* 全割り込み受付可 */
 
-  int hex_lower;
-  int hex_upper;
-
-  /* ここでLCDに表示する文字列を初期化しておく */
-  lcd_clear();
+  /* 最初の表示で画面全体を書く */
+  menu_init(&menu, menu_page, MENU_NUM, MENU_SETSTOP);
 
   while (1){ /* 普段はこのループを実行している */
 
+	if(boot_time[BOOT_LCD] == 0 && lcd_ready()){
+		boot_time[BOOT_LCD] = sched_time();
+	}
+
 	if(disp_flag){
 		disp_flag = 0;
 
-		if(key_read(1) == KEYPOSEDGE){
-			menumode++;
-			menumode%=6;
-			lcd_clear();
-		}
-		/*
-			lcd_cursor(5,1);
-			hex_lower = P6DR%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-			*/
-
-		if(menumode == MENU_SETKP){
-			lcd_cursor(0, 0);
-			lcd_printstr("SET KP");
-			lcd_cursor(0, 1);
-			lcd_printstr("KP=");
-			lcd_cursor(3, 1);
-			lcd_printch('0' + kp);
-			if(key_read(2) == KEYPOSEDGE){
-				kp++;
-				kp%=10;
-			}
-		}else if(menumode == MENU_SETBLACK){
-			lcd_cursor(0, 0);
-			lcd_printstr("SETBLACK");
-
-			lcd_cursor(0,1);
-			hex_upper = (sensor_limit_1/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(1,1);
-			hex_lower = sensor_limit_1%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			lcd_cursor(3,1);
-			hex_upper = (sensor_r[sensor_r_dp]/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(4,1);
-			hex_lower = sensor_r[sensor_r_dp]%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			lcd_cursor(6,1);
-			hex_upper = (sensor_l[sensor_l_dp]/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(7,1);
-			hex_lower = sensor_l[sensor_l_dp]%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			if(key_read(2) == KEYPOSEDGE){
-				sensor_limit_1 = (sensor_r[sensor_r_dp] + sensor_l[sensor_l_dp])/2;
-			}
-		}else if(menumode == MENU_SETWHITE){
-			lcd_cursor(0, 0);
-			lcd_printstr("SETWHITE&A");
-
-			lcd_cursor(0,1);
-			hex_upper = (sensor_limit_2/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(1,1);
-			hex_lower = sensor_limit_2%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			lcd_cursor(3,1);
-			hex_upper = (sensor_r[sensor_r_dp]/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(4,1);
-			hex_lower = sensor_r[sensor_r_dp]%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			lcd_cursor(6,1);
-			hex_upper = (sensor_l[sensor_l_dp]/16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(7,1);
-			hex_lower = sensor_l[sensor_l_dp]%16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			if(key_read(2) == KEYPOSEDGE){
-				sensor_limit_2 = (sensor_r[sensor_r_dp] + sensor_l[sensor_l_dp])/2;
-				sensor_limit = (sensor_limit_1 + sensor_limit_2)/2;
-				target = (sensor_limit + sensor_limit_2)/2;
-			}
-		}else if(menumode == MENU_SETJUMPMODE){
-			lcd_cursor(0, 0);
-			lcd_printstr("SET JUMP");
-			lcd_cursor(0, 1);
-			lcd_printstr("MODE=");
-			lcd_cursor(5, 1);
-			if(jumpmode == JUMPMODE_JUMP){
-				lcd_printch('J');
-			}else if(jumpmode == JUMPMODE_TURNRIGHT){
-				lcd_printch('R');
-			}else if(jumpmode == JUMPMODE_TURNLEFT){
-				lcd_printch('L');
-			}
-			if(key_read(2) == KEYPOSEDGE){
-				jumpmode++;
-				jumpmode%=3;
-			}
-		}else if(menumode == MENU_SETSTOP){
-			lcd_cursor(0, 0);
-			lcd_printstr("SET STOP");
-			lcd_cursor(0, 1);
-			if(global_state == STATE_STOP){
-				lcd_printstr("STOP");
-				lcd_printch('0' + global_state);
-			}else if(global_state == STATE_LINETRACE){
-				lcd_printstr("LINE");
-				lcd_printch('0' + global_state);
-			}
-
-			if(key_read(2) == KEYPOSEDGE){
-				global_state++;
-				global_state%=2;
-			}
-		}else{
-			lcd_cursor(0,0);
-			lcd_printch(global_state + '0');
-
-			lcd_cursor(1,0);
-
-			/*
-			lcd_cursor(3,1);
-			hex_upper = (sensor_state_r[sensor_state_r_dp] /16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(4,1);
-			hex_lower = sensor_state_r[sensor_state_r_dp] %16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-
-			lcd_cursor(6,1);
-			hex_upper = (sensor_state_l[sensor_state_l_dp] /16)%16;
-			if(hex_upper > 9) lcd_printch(hex_upper - 10 + 'a');
-			else lcd_printch(hex_upper + '0');
-
-			lcd_cursor(7,1);
-			hex_lower = sensor_state_l[sensor_state_l_dp] %16;
-			if(hex_lower > 9) lcd_printch(hex_lower - 10 + 'a');
-			else lcd_printch(hex_lower + '0');
-			*/
-
-
-			lcd_cursor(3,1);
-			hex_upper = (motorspeed_r/16)%16;
-			if(hex_upper > 9){
-				lcd_printch(hex_upper - 10 + 'a');
-			}else{
-				lcd_printch(hex_upper + '0');
-			}
-
-			lcd_cursor(4,1);
-			hex_lower = motorspeed_r%16;
-			if(hex_lower > 9){
-				lcd_printch(hex_lower - 10 + 'a');
-			}else{
-				lcd_printch(hex_lower + '0');
-			}
-
-			lcd_cursor(6,1);
-			hex_upper = (motorspeed_l/16)%16;
-			if(hex_upper > 9){
-				lcd_printch(hex_upper - 10 + 'a');
-			}else{
-				lcd_printch(hex_upper + '0');
-			}
-
-			lcd_cursor(7,1);
-			hex_lower = motorspeed_l%16;
-			if(hex_lower > 9){
-				lcd_printch(hex_lower - 10 + 'a');
-			}else{
-				lcd_printch(hex_lower + '0');
-			}
+		/* 制御の状態を同じ周期の組で読む                            */
+		/* 送った設定がまだ反映されていなければ, 送ったものから変える */
+		seq_read(&ctl_view_lock, &disp_view, &ctl_view, sizeof(disp_view));
+		if(ctl_stage_lock.seq == ctl_stage_seen) disp_param = disp_view.param;
+
+		/* 変えた設定は次の制御の周期の初めに反映される */
+		if(menu_update(&menu)) ctl_post(&disp_param);
+
+#ifdef PROFILE
+		/* 一定間隔で割り込み処理の実行時間の集計を SCI2 に送る */
+		prof_report_time++;
+		if(prof_report_time >= PROFREPORTTIME){
+			prof_report_time = 0;
+			prof_report();
 		}
+#endif
 	  }
 
     /* その他の処理はタイマ割り込みによって自動的に実行されるため  */
@@ -362,292 +459,353 @@ void int_imia0(void)
      /* 関数の名前はリンカスクリプトで固定している                   */
      /* 関数の直前に割り込みハンドラ指定の #pragama interrupt が必要 */
      /* タイマ割り込みによって各処理の呼出しが行われる               */
-     /*   呼出しの頻度は KEYTIME,ADTIME,PWMTIME,CONTROLTIME で決まる */
-     /* 全ての処理が終わるまで割り込みはマスクされる                 */
+     /*   呼出しの頻度と位相は sched_table[] で決まる (sched.c)      */
+     /* PWM は8ビットタイマが出力するので, ここで行う処理はない      */
+     /* 受け付けた時点で CCR の I と UI が 1 になるので, フラグを     */
+     /* クリアしてから UI を 0 にし, 優先順位 1 の割り込みだけを許す  */
+     /* (優先順位 0 の割り込みは全ての処理が終わるまでマスクされる)   */
      /* 各処理は基本的に割り込み周期内で終わらなければならない       */
+     /* PROFILE のときは各処理の実行時間を profile.c で集計する       */
 {
-  /* LCD表示の処理 */
-  /* 他の処理を書くときの参考 */
-  disp_time++;
-  if (disp_time >= DISPTIME){
-    disp_flag = 1;
-    disp_time = 0;
-  }
-
-  /* ここにキー処理に分岐するための処理を書く */
-  /* キー処理の中身は全て key.c にある */
-  key_time++;
-  if (key_time >= KEYTIME){
-    key_time = 0;
-	key_sense();
-  }
-
-  /* ここにPWM処理に分岐するための処理を書く */
-  pwm_time++;
-  if (pwm_time >= PWMTIME){
-    pwm_time = 0;
-	pwm_proc();
-  }
-
-  /* ここにA/D変換開始の処理を直接書く */
-  /* A/D変換の初期化・スタート・ストップの処理関数は ad.c にある */
-  ad_time++;
-  if (ad_time >= ADTIME){
-    ad_time = 0;
-	//ad_start(0,1);
-	ad_scan(0,1);
-  }
+  PROF_BEGIN(PROF_IMIA0);
+  timer_intflag_reset(0); /* 割り込みフラグをクリア */
+  ENINT1();               /* 優先順位 1 の割り込みを入れ子で受け付ける */
 
-  /* ここに制御処理に分岐するための処理を書く */
-  control_time++;
-  if (control_time >= CONTROLTIME){
-    control_time = 0;
-	control_proc();
-  }
+  sched_tick();
 
-  timer_intflag_reset(0); /* 割り込みフラグをクリア */
+  PROF_END(PROF_IMIA0);
   ENINT();                /* CPUを割り込み許可状態に */
 }
 
-#pragma interrupt
-void int_adi(void)
-     /* A/D変換終了の割り込みハンドラ                               */
-     /* 関数の名前はリンカスクリプトで固定している                   */
-     /* 関数の直前に割り込みハンドラ指定の #pragma interrupt が必要  */
+void disp_tick(void)
+     /* LCD表示の処理 (DISPTIME ごとにメインループに表示させる) */
 {
-  ad_stop();    /* A/D変換の停止と変換終了フラグのクリア */
+  disp_flag = 1;
+}
 
-  /* ここでバッファポインタの更新を行う */
-  adbufdp++;
-  if(adbufdp >= ADBUFSIZE){
-	  adbufdp = 0;
+static void menu_cal(int white)
+     /* 表示している周期のセンサの値を白(white = 1)または黒として, */
+     /* センサごとの zero, gain を disp_param に求める関数           */
+     /* 除算があるので割り込み処理でなくここで行う. 割り込みは禁止  */
+     /* せず, 求めた組は ctl_post() で次の周期の初めに反映される     */
+{
+  int i;
+
+  for(i = 0; i < SENSOR_NUM; i++) cal_sensors.raw[i] = disp_view.raw[i];
+  if(white) sensor_cal_white(&cal_sensors);
+  else sensor_cal_black(&cal_sensors);
+  for(i = 0; i < SENSOR_NUM; i++){
+	  disp_param.zero[i] = cal_sensors.zero[i];
+	  disp_param.gain[i] = cal_sensors.gain[i];
   }
-  /* 　但し、バッファの境界に注意して更新すること */
-
-  /* ここでバッファにA/Dの各チャネルの変換データを入れる */
-  adbuf[0][adbufdp] = ADDRAH;
-  adbuf[1][adbufdp] = ADDRBH;
-  adbuf[2][adbufdp] = ADDRCH;
-  adbuf[3][adbufdp] = ADDRDH;
-  /* スキャングループ 0 を指定した場合は */
-  /*   A/D ch0〜3 (信号線ではAN0〜3)の値が ADDRAH〜ADDRDH に格納される */
-  /* スキャングループ 1 を指定した場合は */
-  /*   A/D ch4〜7 (信号線ではAN4〜7)の値が ADDRAH〜ADDRDH に格納される */
-
-  ENINT();      /* 割り込みの許可 */
 }
 
-int ad_read(int ch)
-     /* A/Dチャネル番号を引数で与えると, 指定チャネルの平均化した値を返す関数 */
-     /* チャネル番号は，0〜ADCHNUM の範囲 　　　　　　　　　　　             */
-     /* 戻り値は, 指定チャネルの平均化した値 (チャネル指定エラー時はADCHNONE) */
+static int menu_cal_black(void)
+     /* MENU_SETBLACK のキー2: 今のセンサの値を黒として校正する関数 */
 {
-  int i,ad,bp;
-  ad = 0;
-  bp = adbufdp;
-  int tmp = 0;
-
-  if ((ch > ADCHNUM) || (ch < 0)) ad = ADCHNONE; /* チャネル範囲のチェック */
-  else {
-
-    /* ここで指定チャネルのデータをバッファからADAVRNUM個取り出して平均する */
-    /* データを取り出すときに、バッファの境界に注意すること */
-    /* 平均した値が戻り値となる */
-	for(i=0;i<ADAVRNUM;i++){
-		tmp = bp - i;
-		if(tmp < 0) tmp=ADBUFSIZE+tmp;
-		ad+=adbuf[ch][tmp];
-	}
-	ad /= ADAVRNUM;
+  sensor_limit_1 = (disp_view.sensor.r + disp_view.sensor.l) >> 1;
+  menu_cal(0);			/* センサごとの黒のレベル */
+  return 1;
+}
 
-  }
-  return ad; /* データの平均値を返す */
+static int menu_cal_white(void)
+     /* MENU_SETWHITE のキー2: 今のセンサの値を白として校正し, */
+     /* しきい値を決め直す関数                                 */
+{
+  sensor_limit_2 = (disp_view.sensor.r + disp_view.sensor.l) >> 1;
+  menu_cal(1);			/* センサごとの白のレベル */
+  disp_param.limit = (sensor_limit_1 + sensor_limit_2) >> 1;
+  return 1;
 }
 
-void pwm_proc(void)
-     /* PWM制御を行う関数                                        */
-     /* この関数はタイマ割り込み0の割り込みハンドラから呼び出される */
+static void menu_status(void)
+     /* MENU_STATUS の表示の前に呼ばれる関数                       */
+     /* 割り込みの負荷を読む (PROFILE のときは計測の段を表示する) */
 {
-	
+#ifdef PROFILE
+  prof_lcd(prof_disp);
+#else
+  unsigned long over;
+
+  disp_load = sched_load();
+  over = sched_tickover();
+  disp_over = (over > 99) ? 99 : over;
+#endif
+}
 
-  /* ここにPWM制御の中身を書く */
-  if(pwm_count < motorspeed_r ){
-	if(motordirection_r == 0){
-		PBDR |= RMOTOR_IN1;
-		PBDR &= ~RMOTOR_IN2;
-	}else{
-		PBDR &= ~RMOTOR_IN1;
-		PBDR |= RMOTOR_IN2;
-  	}
-  }else{
-	PBDR &= ~RMOTOR_IN1;
-	PBDR &= ~RMOTOR_IN2;
-  }
+static int menu_status_reset(void)
+     /* MENU_STATUS のキー3: 集計をクリアする関数 */
+{
+#ifdef PROFILE
+  prof_reset();
+#else
+  sched_reset();
+#endif
+  return 0;
+}
 
-  if(pwm_count < motorspeed_l){
-	if(motordirection_l == 0){
-		PBDR |= LMOTOR_IN1;
-		PBDR &= ~LMOTOR_IN2;
-	}else{
-		PBDR &= ~LMOTOR_IN1;
-		PBDR |= LMOTOR_IN2;
-	}
-  }else{
-	PBDR &= ~LMOTOR_IN1;
-	PBDR &= ~LMOTOR_IN2;
-  }
+#ifdef PROFILE
+static int menu_prof_next(void)
+     /* MENU_STATUS のキー2: 表示する計測の段を切り替える関数 */
+{
+  prof_disp++;
+  prof_disp%=PROF_NUM;
+  return 0;
+}
+#endif
 
-  pwm_count++;
-  if (pwm_count >= MAXPWMCOUNT){
-    pwm_count = 0;
+static void menu_load(void)
+     /* MENU_LOAD の表示の前に呼ばれる関数                            */
+     /* disp_task の処理の集計を読み, 2行目に負荷のヒストグラムを書く */
+     /* ヒストグラムは周期の 1/8 ごとの段に入った割り込みの割合で,   */
+     /* 1桁が 10% (0 は 10% 未満, 1回もなければ '-')                  */
+{
+  struct sched_stat st;
+  unsigned long h[SCHED_HISTNUM], total, d;
+  int i, c;
+
+  sched_get(disp_task, &st);
+  disp_task_max = sched_percent(st.max);
+  disp_task_over = (st.overrun > 99) ? 99 : st.overrun;
+
+  sched_hist(h);
+  total = 0;
+  for(i = 0; i < SCHED_HISTNUM; i++) total += h[i];
+  d = (total < 10) ? 1 : total / 10;	/* 10% の回数 */
+  lcd_cursor(2, 1);
+  for(i = 0; i < SCHED_HISTNUM; i++){
+	  if(h[i] == 0){
+		  c = '-';
+	  }else{
+		  c = h[i] / d;
+		  c = '0' + ((c > 9) ? 9 : c);
+	  }
+	  lcd_printch(c);
   }
+}
 
+static int menu_load_next(void)
+     /* MENU_LOAD のキー2: 表示する処理を切り替える関数 */
+{
+  disp_task++;
+  if(disp_task >= SCHED_NUM) disp_task = 0;
+  return 0;
+}
 
+static int menu_load_reset(void)
+     /* MENU_LOAD のキー3: 処理ごとの集計とヒストグラムをクリアする関数 */
+{
+  sched_reset();
+  return 0;
 }
 
-#define SENSOR_BLACK 0
-#define SENSOR_WHITE 1
+void ad_filter(void)
+     /* 最新のスキャンを読み出して, 各チャネルのフィルタに入れる関数 */
+     /* 全チャネルが同じスキャンの値になる (ad.c の ad_latest())    */
+{
+  int ch;
 
-volatile int sum;
+  ad_latest(&ad_now);
+  for(ch = 0; ch < ADCHNUM; ch++){
+	  filter_put(&adfilter[ch], ad_now.val[ch]);
+  }
+}
 
-volatile int spent;
+int ad_read(int ch)
+     /* A/Dチャネル番号を引数で与えると, 指定チャネルの平均化した値を返す関数 */
+     /* チャネル番号は，0〜ADCHNUM-1 の範囲 　　　　　　　　　　　           */
+     /* 戻り値は, 指定チャネルのフィルタの出力 (チャネル指定エラー時はADCHNONE) */
+     /* 平均化は ad_filter() でサンプルごとに済んでいるので, 読むだけで良い */
+{
+  if ((ch >= ADCHNUM) || (ch < 0)) return ADCHNONE; /* チャネル範囲のチェック */
+  return filter_out(&adfilter[ch]);
+}
 
 void control_proc(void)
      /* 制御を行う関数                                           */
      /* この関数はタイマ割り込み0の割り込みハンドラから呼び出される */
+     /* 白黒の判定を trace.c の状態機械に入れ, 状態ごとの指令で     */
+     /* モータを動かす (遷移の規則は trace.c の状態表を参照)       */
 {
+	int steer_y;
+	int in, cmd, tmp;
+	int limit, gain, mode, state, jump;
+	struct motor_cmd m;
+	struct sensor_pair sp;
 
 
-volatile static char sensor_state_r[SENSOR_BUFFER_SIZE];
-volatile static int sensor_state_r_dp = 0;
-volatile static char sensor_state_l[SENSOR_BUFFER_SIZE];
-volatile static int sensor_state_l_dp = 0;
 
-	volatile static int jump = 0;
+/* 白黒の判定の履歴 (hist.h, 黒が 1, ビット i が i 周期前) */
+volatile static unsigned long sensor_state_r FASTDATA = 0;
+volatile static unsigned long sensor_state_l FASTDATA = 0;
 
 
 
   /* ここに制御処理を書く */
-	
-	sensor_r_dp++;
-	sensor_l_dp++;
-
-	sensor_r_dp %= SENSOR_BUFFER_SIZE;
-	sensor_l_dp %= SENSOR_BUFFER_SIZE;
-
-	sensor_l[sensor_l_dp] = ad_read(1)/2;
-	sensor_r[sensor_r_dp] = ad_read(2)/2;
-
-
-
-		sensor_state_r_dp++;
-		sensor_state_l_dp++;
-
-		sensor_state_r_dp %= SENSOR_BUFFER_SIZE;
-		sensor_state_l_dp %= SENSOR_BUFFER_SIZE;
-
-		if(sensor_r[sensor_r_dp] > sensor_limit){
-			sensor_state_r[sensor_state_r_dp] = SENSOR_BLACK;
-		}else{
-			sensor_state_r[sensor_state_r_dp] = SENSOR_WHITE;
-		}
-
-		if(sensor_l[sensor_l_dp] > sensor_limit){
-			sensor_state_l[sensor_state_l_dp] = SENSOR_BLACK;
-		}else{
-			sensor_state_l[sensor_state_l_dp] = SENSOR_WHITE;
-		}
-
-	if(global_state == STATE_LINETRACE){
-		if(sensor_state_r[sensor_state_r_dp] == SENSOR_WHITE && sensor_state_l[sensor_state_l_dp] == SENSOR_WHITE ){
-			motorspeed_r = MOTOR_MAXSPEED;
-			motorspeed_l = MOTOR_MAXSPEED;
 
-			spent=0;
-			jump=0;
-			motordirection_r = 0;
-			motordirection_l = 0;
-
-		}else if(sensor_state_r[sensor_state_r_dp] == SENSOR_WHITE && sensor_state_l[sensor_state_l_dp] == SENSOR_BLACK){
-
-			spent++;
-
-			motorspeed_r = MOTOR_MAXSPEED-(spent*kp);
-			motorspeed_l = MOTOR_MAXSPEED;
-
-			if(motorspeed_r < 0) motorspeed_r = 0;
+	ctl_apply();	/* メニューで変えた設定をこの周期から使う */
+	if(boot_time[BOOT_CONTROL] == 0){	/* 最初の周期 */
+		boot_time[BOOT_CONTROL] = sched_time();
+	}
 
-			jump=0;
-			motordirection_r = 0;
-			motordirection_l = 0;
-		}else if(sensor_state_r[sensor_state_r_dp] == SENSOR_BLACK && sensor_state_l[sensor_state_l_dp] == SENSOR_WHITE){
+	/* 設定は volatile なので, ここで1回だけ読んで以降はローカル変数を使う */
+	limit = sensor_limit;
+	gain = kp;
+	mode = steermode;
+	state = global_state;
+	jump = jumpmode;
+	m = motor_now;
 
-			spent++;
+	sensor_update(&sensors, ad_read);
+	sp.r = sensors.raw[SENSOR_R];
+	sp.l = sensors.raw[SENSOR_L];
+	ring_put(&sensor_buf, sp);	/* 左右を書いてから公開する */
 
-			motorspeed_r = MOTOR_MAXSPEED;
-			motorspeed_l = MOTOR_MAXSPEED-(spent*kp);
 
-			if(motorspeed_l < 0) motorspeed_l = 0;
 
-			jump=0;
-			motordirection_r = 0;
-			motordirection_l = 0;
+	hist_push(sensor_state_r, sp.r > limit);
+	hist_push(sensor_state_l, sp.l > limit);
 
-		}else if(sensor_state_r[sensor_state_r_dp] == SENSOR_BLACK && sensor_state_l[sensor_state_l_dp] == SENSOR_BLACK){
-			int i;
-			int dp;
-			int whitecount = 0;
-			int blackcount = 0;
-			for(i=0; i < 10 ; i++){
-				dp=sensor_r_dp - i;
-				if(dp < 0) dp += SENSOR_BUFFER_SIZE;
+	in = 0;
+	if(hist_now(sensor_state_r)) in |= TRACE_IN_R;
+	if(hist_now(sensor_state_l)) in |= TRACE_IN_L;
 
-				if(sensor_state_r[dp] == SENSOR_WHITE && sensor_state_l[dp] == SENSOR_WHITE) whitecount++;
-				if(sensor_state_r[dp] == SENSOR_BLACK && sensor_state_l[dp] == SENSOR_BLACK) blackcount++;
-			}
+	/* STEER_PID の測定値: センサアレイの重心から求めたラインの位置 */
+	/* (ゲインを合わせた大きさに換算し, 0 に向けて丸める)          */
+	steer_y = sensors.line;
+	if(steer_y >= 0) steer_y = (steer_y * STEER_YSCALE) >> 8;
+	else steer_y = -((-steer_y * STEER_YSCALE) >> 8);
 
-			if( whitecount > 5 || jump == 1){ // jump or turn
-				jump = 1;
+	/* ラインの位置を推定する (両方が黒のときは測定値を使わずに外挿) */
+	est_update(&steer_est, steer_y, in != (TRACE_IN_R | TRACE_IN_L));
 
-				if(jumpmode == JUMPMODE_JUMP){
-					motorspeed_r = MOTOR_MAXSPEED;
-					motorspeed_l = MOTOR_MAXSPEED;
-				}else if(jumpmode == JUMPMODE_TURNRIGHT){
-					motorspeed_r = MOTOR_MAXSPEED;
-					motorspeed_l = MOTOR_MAXSPEED;
-					motordirection_r = 1;
-				}else if(jumpmode == JUMPMODE_TURNLEFT){
-					motorspeed_r = MOTOR_MAXSPEED;
-					motorspeed_l = MOTOR_MAXSPEED;
-					motordirection_l = 1;
-				}
-			}else{ // fix control
+	if(state != STATE_LINETRACE){
+		trace_init(&trace_sm);	/* 走り出すときは TRACKING から */
+		cmd = -1;
+	}else{
+		cmd = trace_cmd(trace_update(&trace_sm, in, jump));
+		m.dir[MOTOR_R] = MOTOR_FORWARD;
+		m.dir[MOTOR_L] = MOTOR_FORWARD;
+	}
 
-				if( sensor_state_r[(sensor_state_r_dp-1+SENSOR_BUFFER_SIZE)%SENSOR_BUFFER_SIZE] == SENSOR_WHITE && 
-					sensor_state_l[(sensor_state_l_dp-1+SENSOR_BUFFER_SIZE)%SENSOR_BUFFER_SIZE] == SENSOR_BLACK ){
+	if(cmd < 0){
+		/* 停止中は速度を変えない */
+	}else if(mode == STEER_PID && cmd <= TRACE_CMD_EDGE_R){
+		/* 平均の遅れを補うため, 1周期先の位置の予測で制御する */
+		/* (両方が黒の急カーブでは推定器が外挿した位置になる)   */
+		steer_pid_proc(est_predict(&steer_est), &m);
+	}else{
+		pid_reset(&steer_pid, est_predict(&steer_est));	/* 次に PID に戻ったときのため */
+		m.speed[MOTOR_R] = MOTOR_MAXSPEED;
+		m.speed[MOTOR_L] = MOTOR_MAXSPEED;
+		switch(cmd){
+		case TRACE_CMD_EDGE_L:
+			tmp = MOTOR_MAXSPEED-(trace_spent(&trace_sm)*gain);
+			m.speed[MOTOR_L] = (tmp < 0) ? 0 : tmp;
+			break;
+		case TRACE_CMD_EDGE_R:
+			tmp = MOTOR_MAXSPEED-(trace_spent(&trace_sm)*gain);
+			m.speed[MOTOR_R] = (tmp < 0) ? 0 : tmp;
+			break;
+		case TRACE_CMD_SPIN_L:
+			m.dir[MOTOR_L] = MOTOR_REVERSE;
+			break;
+		case TRACE_CMD_SPIN_R:
+			m.dir[MOTOR_R] = MOTOR_REVERSE;
+			break;
+		default:	/* TRACE_CMD_TRACK, TRACE_CMD_STRAIGHT */
+			break;
+		}
+	}
 
-					spent++;
+	/* 決めた速度と方向をまとめて書き戻し, PWM の出力に反映する */
+	motor_now = m;
+	motor_commit(&m);
 
-					motorspeed_r = MOTOR_MAXSPEED-(spent*kp);
-					motorspeed_l = MOTOR_MAXSPEED;
+	ctl_publish();	/* この周期の結果をメインループに渡す */
+}
 
-					sensor_state_r[sensor_state_r_dp] = SENSOR_WHITE;
-					sensor_state_l[sensor_state_l_dp] = SENSOR_BLACK;
+static void ctl_post(const struct ctl_param *p)
+     /* メニューで変えた設定を control_proc() に送る関数 (メインループ用)  */
+     /* 書いている途中の組は ctl_apply() が読まないので割り込みは禁止しない */
+     /* 反映される前に送り直したときは新しい組で上書きする                  */
+{
+  seq_write_begin(&ctl_stage_lock);
+  ctl_stage = *p;
+  seq_write_end(&ctl_stage_lock);
+}
 
+static void ctl_apply(void)
+     /* ctl_post() で送られた設定を制御の変数に書く関数              */
+     /* control_proc() の初めに呼ぶ. 新しい組がないときや書いている  */
+     /* 途中のときは何もしない (待たずに次の周期で反映する)          */
+{
+  struct ctl_param p;
+  int i;
 
-				} else if( sensor_state_r[(sensor_state_r_dp-1+SENSOR_BUFFER_SIZE)%SENSOR_BUFFER_SIZE] == SENSOR_BLACK && 
-						   sensor_state_l[(sensor_state_l_dp-1+SENSOR_BUFFER_SIZE)%SENSOR_BUFFER_SIZE] == SENSOR_WHITE ){
+  if(!seq_fetch(&ctl_stage_lock, &ctl_stage_seen, &p, &ctl_stage, sizeof(p))) return;
+  sensor_limit = p.limit;
+  global_state = p.state;
+  kp = p.kp;
+  jumpmode = p.jump;
+  steermode = p.steer;
+  steer_pid.kp = p.pid_kp;
+  steer_pid.ki = p.pid_ki;
+  steer_pid.kd = p.pid_kd;
+  for(i = 0; i < SENSOR_NUM; i++){
+	  sensors.zero[i] = p.zero[i];
+	  sensors.gain[i] = p.gain[i];
+  }
+}
 
-					spent++;
-					motorspeed_r = MOTOR_MAXSPEED;
-					motorspeed_l = MOTOR_MAXSPEED-(spent*kp);
+static void ctl_publish(void)
+     /* 最新のセンサの値, 指令, 状態と使っている設定を ctl_view に書く関数 */
+     /* control_proc() の終わりに呼ぶ (初期化のときはメインループから)     */
+{
+  int i;
 
-					sensor_state_r[sensor_state_r_dp] = SENSOR_BLACK;
-					sensor_state_l[sensor_state_l_dp] = SENSOR_WHITE;
-				}
-			}
-		}
+  seq_write_begin(&ctl_view_lock);
+  ctl_view.sensor = ring_last(&sensor_buf, 0);
+  for(i = 0; i < SENSOR_NUM; i++) ctl_view.raw[i] = sensors.raw[i];
+  ctl_view.motor = motor_now;
+  ctl_view.trace = trace_state(&trace_sm);
+  ctl_view.param.limit = sensor_limit;
+  ctl_view.param.state = global_state;
+  ctl_view.param.kp = kp;
+  ctl_view.param.jump = jumpmode;
+  ctl_view.param.steer = steermode;
+  ctl_view.param.pid_kp = steer_pid.kp;
+  ctl_view.param.pid_ki = steer_pid.ki;
+  ctl_view.param.pid_kd = steer_pid.kd;
+  for(i = 0; i < SENSOR_NUM; i++){
+	  ctl_view.param.zero[i] = sensors.zero[i];
+	  ctl_view.param.gain[i] = sensors.gain[i];
+  }
+  seq_write_end(&ctl_view_lock);
+}
 
+void steer_pid_proc(int y, struct motor_cmd *m)
+     /* PID でステアリングを行う関数 (control_proc() から呼ばれる)      */
+     /* 求めた速度は m に書く                                           */
+     /* y: ラインの位置の予測 (STEER_YSCALE で換算, 目標は 0, AN1 側が正) */
+     /* 操作量 u を右に +u, 左に -u として両輪に振り分け, 一方が最大を   */
+     /* 越えたら越えた分だけ他方を下げて, 左右の差を保ったまま飽和させる */
+{
+	int u, r, l;
+
+	u = pid_update(&steer_pid, -y, y);
+	r = MOTOR_MAXSPEED + u;
+	l = MOTOR_MAXSPEED - u;
+	if(r > MOTOR_MAXSPEED){
+		l -= r - MOTOR_MAXSPEED;
+		r = MOTOR_MAXSPEED;
 	}
-
+	if(l > MOTOR_MAXSPEED){
+		r -= l - MOTOR_MAXSPEED;
+		l = MOTOR_MAXSPEED;
+	}
+	if(r < 0) r = 0;
+	if(l < 0) l = 0;
+	m->speed[MOTOR_R] = r;
+	m->speed[MOTOR_L] = l;
 }
@@ -0,0 +1,222 @@
+#include <string.h>
+#include "lcd.h"
+#include "key.h"
+#include "menu.h"
+
+/* menu.shown のビット */
+#define MENU_SHOWN  0x01   /* 欄を表示している */
+#define MENU_MARKED 0x02   /* 印 '>' を表示している */
+
+void menu_init(struct menu *m, const struct menu_page *page, int num, int start);
+int menu_update(struct menu *m);
+
+static int menu_get(const struct menu_field *f)
+     /* 欄の変数の値を返す関数 */
+{
+  switch (f->size) {
+  case 1: return *(volatile unsigned char *)f->var;
+  case 2: return *(volatile short *)f->var;
+  case 4: return *(volatile int *)f->var;
+  }
+  return 0;
+}
+
+static void menu_set(const struct menu_field *f, int v)
+     /* 欄の変数に v を書く関数 */
+{
+  switch (f->size) {
+  case 1: *(volatile unsigned char *)f->var = v; break;
+  case 2: *(volatile short *)f->var = v; break;
+  case 4: *(volatile int *)f->var = v; break;
+  }
+}
+
+static int menu_visible(const struct menu_field *f)
+     /* 欄を表示するとき 1 を返す関数 */
+{
+  return (f->when == NULL) || (*f->when == f->is);
+}
+
+static void menu_select(struct menu *m, int from)
+     /* 欄 from から順に, 表示している変えられる欄を選ぶ関数 */
+     /* (最後の次は最初. 1つもなければ選ばない)              */
+{
+  const struct menu_page *p = &m->page[m->cur];
+  const struct menu_field *f;
+  int i, n;
+
+  if (from < 0) from = 0;
+  for (i = 0; i < p->num; i++) {
+    n = (from + i) % p->num;
+    f = &p->field[n];
+    if ((f->max != 0) && menu_visible(f)) {
+      m->sel = n;
+      return;
+    }
+  }
+  m->sel = -1;
+}
+
+static const char *menu_text(const struct menu_field *f, int v)
+     /* 文字列の欄の値 v のときの文字列を返す関数 */
+{
+  switch (f->type) {
+  case MENU_LABEL: return f->names[0];
+  case MENU_ENUM:  return f->names[v];
+  case MENU_STR:   return f->str(v);
+  }
+  return "";
+}
+
+static int menu_width(const struct menu_field *f, int v)
+     /* 欄の値 v のときの表示の桁数を返す関数 */
+{
+  switch (f->type) {
+  case MENU_DIGIT: return 1;
+  case MENU_DEC2:  return 3;
+  case MENU_HEX2:  return 2;
+  case MENU_HEX3:  return 3;
+  }
+  return strlen(menu_text(f, v));
+}
+
+static void menu_hex(int v, int digits)
+     /* v の下位 digits 桁を16進数で表示する関数 */
+{
+  int i, hex;
+
+  for (i = (digits - 1) * 4; i >= 0; i -= 4) {
+    hex = (v >> i) & 0x0f;
+    if (hex > 9) lcd_printch(hex - 10 + 'a');
+    else lcd_printch(hex + '0');
+  }
+}
+
+static void menu_draw(const struct menu_field *f, int v)
+     /* 欄を値 v で表示する関数 */
+{
+  lcd_cursor(f->x, f->y);
+  switch (f->type) {
+  case MENU_DIGIT:
+    lcd_printch('0' + v % 10);
+    break;
+  case MENU_DEC2:
+    if (v < 0) v = 0;
+    if (v > 99) v = 99;
+    lcd_printch(f->name);
+    lcd_printch('0' + v / 10);
+    lcd_printch('0' + v % 10);
+    break;
+  case MENU_HEX2:
+    menu_hex(v, 2);
+    break;
+  case MENU_HEX3:
+    menu_hex(v, 3);
+    break;
+  default:
+    lcd_printstr((unsigned char *)menu_text(f, v));
+    break;
+  }
+}
+
+static void menu_erase(const struct menu_field *f, int v)
+     /* 値 v で表示していた欄(と印)を空白で消す関数 */
+{
+  int x, n;
+
+  x = f->x;
+  n = menu_width(f, v);
+  if (f->flags & MENU_MARK) {
+    x--;
+    n++;
+  }
+  lcd_cursor(x, f->y);
+  while (n-- > 0) lcd_printch(' ');
+}
+
+void menu_init(struct menu *m, const struct menu_page *page, int num, int start)
+     /* メニューの初期化関数 */
+{
+  m->page = page;
+  m->num = num;
+  m->cur = start;
+  m->redraw = 1;
+  menu_select(m, 0);
+}
+
+int menu_update(struct menu *m)
+     /* キーを1回ずつ読んで処理し, 画面を表示する関数                 */
+     /* 画面を切り替えたときは全体を書き, それ以外は表示の有無や値, 印 */
+     /* が前に表示したものと違う欄だけを書き直す                       */
+     /* 隠れた欄を先に消すので, 同じ位置に条件の違う欄を重ねても良い   */
+{
+  const struct menu_page *p;
+  const struct menu_field *f;
+  int next, inc, sel, changed, i, v, s;
+
+  /* key_read() は前に読んだときからの変化を返すので, 画面によらず毎回読む */
+  next = (key_read(MENU_KEY_NEXT) == KEYPOSEDGE);
+  inc = (key_read(MENU_KEY_INC) == KEYPOSEDGE);
+  sel = (key_read(MENU_KEY_SEL) == KEYPOSEDGE);
+  changed = 0;
+
+  p = &m->page[m->cur];
+  if (next) {
+    m->cur = (m->cur + 1) % m->num;
+    m->redraw = 1;
+    menu_select(m, 0);
+    p = &m->page[m->cur];
+  } else {
+    if (sel) {
+      if (p->key_sel != NULL) changed |= p->key_sel();
+      else menu_select(m, m->sel + 1);
+    }
+    if (inc) {
+      if (p->key_inc != NULL) {
+        changed |= p->key_inc();
+      } else if (m->sel >= 0) {
+        f = &p->field[m->sel];
+        v = menu_get(f);
+        menu_set(f, (v >= f->max) ? 0 : v + 1);
+        changed = 1;
+      }
+    }
+  }
+  /* 値を変えて選んでいた欄が隠れたら, 次の欄を選ぶ */
+  if ((m->sel >= 0) && !menu_visible(&p->field[m->sel])) menu_select(m, m->sel + 1);
+
+  if (m->redraw) {
+    m->redraw = 0;
+    lcd_clear();
+    if (p->title != NULL) {
+      lcd_cursor(0, 0);
+      lcd_printstr((unsigned char *)p->title);
+    }
+    for (i = 0; i < p->num; i++) m->shown[i] = 0;
+  }
+  if (p->update != NULL) p->update();
+
+  for (i = 0; i < p->num; i++) {
+    f = &p->field[i];
+    if (!menu_visible(f) && (m->shown[i] & MENU_SHOWN)) {
+      menu_erase(f, m->last[i]);
+      m->shown[i] = 0;
+    }
+  }
+  for (i = 0; i < p->num; i++) {
+    f = &p->field[i];
+    if (!menu_visible(f)) continue;
+    v = (f->type == MENU_LABEL) ? 0 : menu_get(f);
+    s = MENU_SHOWN;
+    if ((f->flags & MENU_MARK) && (m->sel == i)) s |= MENU_MARKED;
+    if ((m->shown[i] == s) && (m->last[i] == v)) continue;
+    if (f->flags & MENU_MARK) {
+      lcd_cursor(f->x - 1, f->y);
+      lcd_printch((s & MENU_MARKED) ? '>' : ' ');
+    }
+    menu_draw(f, v);
+    m->last[i] = v;
+    m->shown[i] = s;
+  }
+  return changed;
+}
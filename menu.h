@@ -0,0 +1,78 @@
+// menu.c を利用するために必要なヘッダファイル
+// LCD のメニュー画面を表で書く (画面ごとに題名, 欄の並び, キーの処理)
+//
+// 欄は型と表示位置と変数をもち, menu_update() が変数を読んで表示する
+// 値が前の表示から変わった欄だけを書き直すので, 変わらない画面では
+// LCD の関数を呼ばない (画面を切り替えたときだけ全体を書く)
+// 画面を増やすときは, 欄の表と画面の表に行を足すだけで良い
+//
+// キーは menu_update() が表示の周期ごとに1回ずつ読む
+//   MENU_KEY_NEXT : 次の画面 (最後の次は最初)
+//   MENU_KEY_SEL  : 変えられる欄(max が 0 でない欄)を順に選ぶ
+//   MENU_KEY_INC  : 選んだ欄の値を 1 増やす (max を越えると 0)
+// 画面に key_inc, key_sel の関数を書いたときは, その関数を代わりに呼ぶ
+
+#define MENU_KEY_NEXT 1    /* キー番号 (key.h) */
+#define MENU_KEY_INC  2
+#define MENU_KEY_SEL  3
+
+#define MENU_FIELDMAX 12   /* 1画面の欄の数 */
+
+/* 欄の型 */
+#define MENU_LABEL 0       /* 文字列 names[0] (変数は使わない) */
+#define MENU_DIGIT 1       /* 10進1桁 */
+#define MENU_DEC2  2       /* 名前 name と10進2桁 (99 で飽和) */
+#define MENU_HEX2  3       /* 16進2桁 (下位8ビット) */
+#define MENU_HEX3  4       /* 16進3桁 (下位12ビット, センサの値など) */
+#define MENU_ENUM  5       /* 文字列 names[値] (names は同じ長さにする) */
+#define MENU_STR   6       /* 文字列 str(値) (同じ長さの文字列を返すこと) */
+
+/* 欄の flags */
+#define MENU_MARK  0x01    /* 選んでいるとき左に '>' を表示する */
+
+/* 欄 */
+struct menu_field {
+  unsigned char type;          /* MENU_LABEL - MENU_STR */
+  unsigned char x, y;          /* 表示位置 (MENU_MARK のときは x-1 に印) */
+  char name;                   /* MENU_DEC2 の名前 */
+  volatile void *var;          /* 変数 (メインループの変数) */
+  unsigned char size;          /* 変数のバイト数 (1, 2, 4:int) */
+  unsigned char max;           /* 変えられる欄の最大値 (0 なら表示だけ) */
+  unsigned char flags;
+  const char *const *names;    /* MENU_LABEL, MENU_ENUM の文字列 */
+  const char *(*str)(int v);   /* MENU_STR の文字列 */
+  const volatile unsigned char *when; /* NULL でなければ, *when が is の */
+  unsigned char is;                   /* ときだけ表示する                */
+};
+
+#define MENU_VAR(v) ((volatile void *)&(v)), sizeof(v)
+     /* menu_field の var, size を書くマクロ */
+
+/* 画面 */
+struct menu_page {
+  const char *title;           /* (0,0) に表示する題名 (NULL なら表示しない) */
+  const struct menu_field *field;
+  unsigned char num;           /* 欄の数 (MENU_FIELDMAX まで) */
+  int (*key_inc)(void);        /* MENU_KEY_INC の処理 (NULL なら欄を増やす) */
+  int (*key_sel)(void);        /* MENU_KEY_SEL の処理 (NULL なら欄を選ぶ) */
+  void (*update)(void);        /* 欄を表示する前に毎回呼ぶ (NULL ならなし) */
+                               /*   表示する値を求めたり, 表で書けない表示をする */
+};
+     /* key_inc, key_sel は設定を変えたら 1 を返す */
+
+/* メニューの状態 */
+struct menu {
+  const struct menu_page *page;
+  int num;                     /* 画面の数 */
+  int cur;                     /* 表示している画面 */
+  int sel;                     /* 選んでいる欄 (-1 ならなし) */
+  int redraw;                  /* 1 なら次は全体を書く */
+  int last[MENU_FIELDMAX];     /* 欄ごとの表示している値 */
+  unsigned char shown[MENU_FIELDMAX]; /* 欄ごとの表示の有無と印 */
+};
+
+extern void menu_init(struct menu *m, const struct menu_page *page, int num, int start);
+     /* 画面の表 page[0 - num-1] を登録し, 画面 start を表示するようにする */
+extern int menu_update(struct menu *m);
+     /* キーを処理し, 変わった欄を表示する (表示の周期ごとに呼ぶ)  */
+     /* 欄の値や key_inc, key_sel で設定を変えたときは 1 を返す    */
@@ -0,0 +1,95 @@
+#include "h8-3069-iodef.h"
+#include "motor.h"
+#include "fastram.h"
+
+/* TCSR の出力選択(OS3-0)                                  */
+/*   OS1-0 : TCORA のコンペアマッチ, OS3-2 : TCORB のコンペアマッチ */
+#define MOTOR_OUT0   0x05    /* 常に 0 を出力 */
+#define MOTOR_OUT1   0x0a    /* 常に 1 を出力 */
+#define MOTOR_OUTPWM 0x06    /* A で 1, B で 0 (PWM) */
+
+/* PB0-3 の順の各チャネルのレジスタ */
+static volatile unsigned char * const motor_tcr[4] = {
+  &T8TCR0, &T8TCR1, &T8TCR2, &T8TCR3
+};
+static volatile unsigned char * const motor_tcsr[4] FASTCONST = {
+  &T8TCSR0, &T8TCSR1, &T8TCSR2, &T8TCSR3
+};
+static volatile unsigned char * const motor_tcora[4] = {
+  &TCORA0, &TCORA1, &TCORA2, &TCORA3
+};
+static volatile unsigned char * const motor_tcorb[4] FASTCONST = {
+  &TCORB0, &TCORB1, &TCORB2, &TCORB3
+};
+
+/* 各チャネルに現在設定している出力選択 */
+static unsigned char motor_os[4] FASTDATA;
+
+void motor_init(void);
+void motor_set(int motor, int speed, int dir) FASTCODE;
+void motor_commit(const struct motor_cmd *c) FASTCODE;
+static void motor_out(int ch, unsigned char os) FASTCODE;
+
+static void motor_out(int ch, unsigned char os)
+     /* 出力選択が変わるときだけ TCSR を書き換える関数        */
+     /* コンペアマッチのフラグは 0 を書いてクリアする         */
+     /* ch0 の ADTE(A/D変換の起動, ad.c が設定する)は保存する */
+{
+  if (motor_os[ch] != os) {
+    *motor_tcsr[ch] = os | (*motor_tcsr[ch] & 0x10);
+    motor_os[ch] = os;
+  }
+}
+
+void motor_init(void)
+     /* モータ出力の初期化関数                                     */
+     /* 周期 MOTOR_PWMPERIOD カウントで4チャネルとも PWM を動作させる */
+     /* 出力は全て 0 (両モータとも惰性) から始める                 */
+{
+  int ch;
+
+  for (ch = 0; ch < 4; ch++) {
+    *motor_tcr[ch] = 0x00;                  /* カウント停止 */
+    *motor_tcsr[ch] = MOTOR_OUT0;
+    motor_os[ch] = MOTOR_OUT0;
+    *motor_tcora[ch] = MOTOR_PWMPERIOD - 1; /* 周期 MOTOR_PWMPERIOD カウント */
+    *motor_tcorb[ch] = 0;
+  }
+  for (ch = 0; ch < 4; ch++) {
+    /* コンペアマッチAでクリア, 割り込み禁止 */
+    *motor_tcr[ch] = 0x08 | MOTOR_PWMCLK;
+  }
+}
+
+void motor_set(int motor, int speed, int dir)
+     /* モータの速度と回転方向を設定する関数                    */
+     /* PWM を出さない方の入力は 0 にする(ブレーキは使わない)   */
+     /* 割り込みハンドラから呼び出しても良い                     */
+{
+  int pwm, low;
+  unsigned char os;
+
+  pwm = (motor == MOTOR_R) ? 2 : 0;     /* IN1 のチャネル */
+  low = pwm + 1;                        /* IN2 のチャネル */
+  if (dir == MOTOR_REVERSE) {
+    low = pwm;
+    pwm = pwm + 1;
+  }
+  if (speed <= 0) {
+    os = MOTOR_OUT0;
+  } else if (speed >= MOTOR_PWMMAX) {
+    os = MOTOR_OUT1;
+  } else {
+    *motor_tcorb[pwm] = speed - 1;      /* speed カウントの間 1 を出力 */
+    os = MOTOR_OUTPWM;
+  }
+  motor_out(low, MOTOR_OUT0);
+  motor_out(pwm, os);
+}
+
+void motor_commit(const struct motor_cmd *c)
+     /* 指令をまとめて出力する関数 */
+{
+  motor_set(MOTOR_R, c->speed[MOTOR_R], c->dir[MOTOR_R]);
+  motor_set(MOTOR_L, c->speed[MOTOR_L], c->dir[MOTOR_L]);
+}
@@ -0,0 +1,48 @@
+// motor.c を利用するために必要なヘッダファイル
+// モータドライバ(H ブリッジ)を 8ビットタイマのハードウェア PWM で駆動する
+//
+// モータドライバの入力はポートBの PB0-3 に接続されており, これらの端子は
+// 8ビットタイマの出力 TMO0, TMIO1, TMO2, TMIO3 と兼用になっている
+//   PB0 : 左モータ IN1 (TMO0)     PB1 : 左モータ IN2 (TMIO1)
+//   PB2 : 右モータ IN1 (TMO2)     PB3 : 右モータ IN2 (TMIO3)
+// 各チャネルは TCORA のコンペアマッチでカウンタをクリアして 1 を出力し,
+// TCORB のコンペアマッチで 0 を出力する (TCORB がデューティを決める)
+
+#define MOTOR_L 0            /* 左モータ */
+#define MOTOR_R 1            /* 右モータ */
+
+#define MOTOR_FORWARD 0      /* 正転 (IN1 に PWM, IN2 は 0) */
+#define MOTOR_REVERSE 1      /* 逆転 (IN1 は 0, IN2 に PWM) */
+
+#define MOTOR_PWMMAX 255     /* デューティ 100% の速度指令値 */
+
+/* PWM の周期[カウント]                                                  */
+/*   256 カウント(φ/8 で 2048 ステート)は A/D変換器の4チャネルのスキャン */
+/*   (512 ステート)のちょうど4回分で, ADSYNC のときに PWM の周期と       */
+/*   A/D変換の位相が揃ったままになる (ad.c の ad_sync_start() を参照)    */
+#define MOTOR_PWMPERIOD 256
+
+/* PWM のキャリア周波数の選択 (8ビットタイマの TCR の CKS)                */
+/*   1 : φ/8    (25MHz / 8 / 256 = 12.2kHz)                              */
+/*   2 : φ/64   (25MHz / 64 / 256 = 1.53kHz)                             */
+/*   3 : φ/8192 (25MHz / 8192 / 256 = 12Hz, 動作確認用)                  */
+#define MOTOR_PWMCLK 1
+
+/* 両方のモータへの指令 (motor_commit() でまとめて出力する) */
+struct motor_cmd {
+  short speed[2];            /* MOTOR_L, MOTOR_R の速度 (0-MOTOR_PWMMAX) */
+  unsigned char dir[2];      /* MOTOR_L, MOTOR_R の方向 (MOTOR_FORWARD, MOTOR_REVERSE) */
+};
+
+extern void motor_init(void);
+     /* 8ビットタイマ ch0-3 を PWM 出力に設定し, 両方のモータを停止する */
+extern void motor_set(int motor, int speed, int dir);
+     /* モータの速度と回転方向を設定する                               */
+     /*   motor : MOTOR_L, MOTOR_R                                      */
+     /*   speed : 0-MOTOR_PWMMAX (デューティ speed/MOTOR_PWMPERIOD,     */
+     /*           MOTOR_PWMMAX 以上は 100%)                             */
+     /*   dir   : MOTOR_FORWARD, MOTOR_REVERSE                          */
+     /* 方向と 0%, 100% の切り替えがなければ TCORB への書き込み1回で済む */
+extern void motor_commit(const struct motor_cmd *c);
+     /* 両方のモータの速度と方向を続けて設定する                         */
+     /* 割り込みハンドラから呼べば, 途中で他の処理が割り込むことはない */
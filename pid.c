@@ -0,0 +1,39 @@
+#include "pid.h"
+#include "fastram.h"
+
+void pid_init(struct pid *p, int kp, int ki, int kd, int ilimit);
+void pid_reset(struct pid *p, int y) FASTCODE;
+int pid_update(struct pid *p, int e, int y) FASTCODE;
+
+void pid_init(struct pid *p, int kp, int ki, int kd, int ilimit)
+     /* PID 制御器の初期化関数 */
+{
+  p->kp = kp;
+  p->ki = ki;
+  p->kd = kd;
+  p->ilimit = (long)ilimit << PID_SHIFT;
+  pid_reset(p, 0);
+}
+
+void pid_reset(struct pid *p, int y)
+     /* 積分と微分の状態をクリアする関数 */
+{
+  p->integ = 0;
+  p->prev = y;
+}
+
+int pid_update(struct pid *p, int e, int y)
+     /* 操作量を求める関数                                   */
+     /*   u = Kp*e + Σ Ki*e - Kd*(y - 前回の y)               */
+     /* 割り込みハンドラから呼ぶので乗算とシフトだけで計算する */
+{
+  long u;
+
+  p->integ += (long)p->ki * e;
+  if (p->integ > p->ilimit) p->integ = p->ilimit;
+  else if (p->integ < -p->ilimit) p->integ = -p->ilimit;
+
+  u = (long)p->kp * e + p->integ - (long)p->kd * (y - p->prev);
+  p->prev = y;
+  return (int)(u >> PID_SHIFT);
+}
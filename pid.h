@@ -0,0 +1,23 @@
+// pid.c を利用するために必要なヘッダファイル
+// 固定小数点(整数演算)の PID 制御器
+//
+// ゲインは 2^PID_SHIFT 倍した整数で持ち, 操作量はシフトで戻すので除算は使わない
+// 微分は偏差ではなく測定値の変化から求める(目標値を変えても飛ばない)
+// 積分は ilimit で上下を制限する(ワインドアップ対策)
+
+#define PID_SHIFT 3          /* ゲインの小数部のビット数 (ゲイン 1 = 8) */
+
+struct pid {
+  int kp, ki, kd;            /* ゲイン x 2^PID_SHIFT */
+  long integ;                /* 積分項(ki を掛けた後) x 2^PID_SHIFT */
+  long ilimit;               /* integ の上下限 */
+  int prev;                  /* 前回の測定値 */
+};
+
+extern void pid_init(struct pid *p, int kp, int ki, int kd, int ilimit);
+     /* ゲインと積分の上下限(操作量の単位)を設定し, 積分をクリアする */
+extern void pid_reset(struct pid *p, int y);
+     /* 積分をクリアし, 前回の測定値を y にする (制御を再開するときに呼ぶ) */
+extern int pid_update(struct pid *p, int e, int y);
+     /* 偏差 e(目標値 - 測定値)と測定値 y から操作量を求める */
+     /* 1制御周期に1回呼ぶ                                    */
@@ -0,0 +1,175 @@
+#include "h8-3069-iodef.h"
+#include "intr.h"
+#include "profile.h"
+#include "fastram.h"
+
+#ifdef PROFILE
+
+#include "timer.h"
+#include "lcd.h"
+#include "tools/sci2.h"
+
+/* φ=25MHz のときの 1us あたりのカウント数 */
+#define PROFCONST1us 25
+
+/* 段ごとの集計 */
+struct prof_stat {
+  unsigned short min, max;     /* 最小, 最大の実行時間(φ単位) */
+  unsigned long sum;           /* 実行時間の合計(平均を求める) */
+  unsigned long count;         /* 計測回数 */
+  unsigned long overrun;       /* 予算を越えた回数 */
+};
+
+volatile unsigned short prof_start[PROF_NUM] FASTDATA;
+static volatile struct prof_stat prof_stat[PROF_NUM] FASTDATA;
+
+/* 段ごとの予算(φ単位) */
+/*   int_imia0 は割り込み周期(1ms), 各段はその内訳の目安 */
+static const unsigned short prof_budget[PROF_NUM] FASTCONST = {
+  1000 * PROFCONST1us,   /* PROF_IMIA0   */
+  100 * PROFCONST1us,    /* PROF_KEY     */
+  50 * PROFCONST1us,     /* PROF_AD      */
+  500 * PROFCONST1us     /* PROF_CONTROL */
+};
+
+/* LCD と SCI2 に表示する段の名前(3文字) */
+static const char *prof_name[PROF_NUM] = {
+  "ITU", "KEY", "AD ", "CTL"
+};
+
+void prof_init(void);
+void prof_end(int n, unsigned short t) FASTCODE;
+void prof_reset(void);
+void prof_lcd(int n);
+void prof_report(void);
+
+static void prof_clear(void)
+     /* 全ての段の集計をクリアする関数 */
+{
+  int n;
+
+  for (n = 0; n < PROF_NUM; n++) {
+    prof_stat[n].min = 0xffff;
+    prof_stat[n].max = 0;
+    prof_stat[n].sum = 0;
+    prof_stat[n].count = 0;
+    prof_stat[n].overrun = 0;
+  }
+}
+
+void prof_init(void)
+     /* 計測の初期化関数                                     */
+     /* timer_init() の後, 割り込みを許可する前に呼び出すこと */
+{
+  prof_clear();
+  timer_freerun(PROF_TIMER_CH);
+  init_sci2();
+}
+
+void prof_end(int n, unsigned short t)
+     /* 段 n の実行時間 t を集計する関数                  */
+     /* 割り込みハンドラから呼ばれるので除算は使わない    */
+{
+  volatile struct prof_stat *s = &prof_stat[n];
+
+  if (t < s->min) s->min = t;
+  if (t > s->max) s->max = t;
+  if (s->sum & 0x80000000) {   /* あふれる前に半分にする(平均は変わらない) */
+    s->sum >>= 1;
+    s->count >>= 1;
+  }
+  s->sum += t;
+  s->count++;
+  if (t > prof_budget[n]) s->overrun++;
+}
+
+void prof_reset(void)
+     /* 集計をクリアする関数 (メインループから呼ぶ) */
+{
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  prof_clear();
+  INTR_UNLOCK(lock);
+}
+
+static void prof_get(int n, struct prof_stat *s)
+     /* 段 n の集計を割り込みを禁止して読み出す関数 */
+{
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  s->min = prof_stat[n].min;
+  s->max = prof_stat[n].max;
+  s->sum = prof_stat[n].sum;
+  s->count = prof_stat[n].count;
+  s->overrun = prof_stat[n].overrun;
+  INTR_UNLOCK(lock);
+}
+
+static void prof_dec(char *buf, unsigned long v, int w)
+     /* v を w 桁の10進数(右詰め, 空白埋め)の文字列にする関数 */
+     /* 桁があふれたときは全て '*' にする                     */
+{
+  int i;
+
+  buf[w] = '\0';
+  for (i = w - 1; i >= 0; i--) {
+    buf[i] = (v > 0 || i == w - 1) ? '0' + v % 10 : ' ';
+    v /= 10;
+  }
+  if (v > 0) {
+    for (i = 0; i < w; i++) buf[i] = '*';
+  }
+}
+
+void prof_lcd(int n)
+     /* MENU_STATUS 画面に段 n の集計を表示する関数      */
+     /*   1行目: 段の名前, 平均[us], 最大[us]            */
+     /*   2行目の 9桁目から: 予算を越えた回数            */
+{
+  struct prof_stat s;
+  char buf[8];
+
+  prof_get(n, &s);
+  lcd_cursor(2, 0);
+  lcd_printstr((unsigned char *)prof_name[n]);
+  lcd_printch(' ');
+  prof_dec(buf, s.count ? s.sum / s.count / PROFCONST1us : 0, 4);
+  lcd_printstr((unsigned char *)buf);
+  lcd_printch(' ');
+  prof_dec(buf, s.max / PROFCONST1us, 4);
+  lcd_printstr((unsigned char *)buf);
+  lcd_cursor(9, 1);
+  lcd_printch('O');
+  prof_dec(buf, s.overrun, 6);
+  lcd_printstr((unsigned char *)buf);
+}
+
+void prof_report(void)
+     /* 全ての段の集計を SCI2 に1行ずつ送信する関数              */
+     /*   名前 回数 最小 平均 最大[φ単位] 超過回数               */
+     /* 送信が終わるまで CPU を占有するので, メインループで呼ぶこと */
+{
+  struct prof_stat s;
+  char buf[12];
+  int n;
+
+  putstr("stage     count   min  mean   max  overrun", SENDCR);
+  for (n = 0; n < PROF_NUM; n++) {
+    prof_get(n, &s);
+    putstr((char *)prof_name[n], NOTSENDCR);
+    prof_dec(buf, s.count, 10);
+    putstr(buf, NOTSENDCR);
+    prof_dec(buf, s.count ? s.min : 0, 6);
+    putstr(buf, NOTSENDCR);
+    prof_dec(buf, s.count ? s.sum / s.count : 0, 6);
+    putstr(buf, NOTSENDCR);
+    prof_dec(buf, s.max, 6);
+    putstr(buf, NOTSENDCR);
+    prof_dec(buf, s.overrun, 9);
+    putstr(buf, SENDCR);
+  }
+}
+
+#endif /* PROFILE */
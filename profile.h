@@ -0,0 +1,45 @@
+// profile.c を利用するために必要なヘッダファイル
+// 割り込み処理の各段の実行時間を計測する (make PROFILE=true のときだけ有効)
+//
+// ITU ch1 をフリーランさせ, PROF_BEGIN() と PROF_END() の間の 16CNT の差を
+// φ(40ns)単位の実行時間として段ごとに集計する
+// PROFILE が定義されていないときは, マクロは何も生成せず profile.c も空になる
+// ので, 計測の呼び出しを残したままでも実行時間とメモリは一切増えない
+
+#define PROF_TIMER_CH 1      /* フリーランさせるタイマのチャネル */
+
+/* 計測する段 */
+#define PROF_IMIA0   0       /* int_imia0() 全体 */
+#define PROF_KEY     1       /* key_sense() */
+#define PROF_AD      2       /* ad_filter() */
+#define PROF_CONTROL 3       /* control_proc() */
+#define PROF_NUM     4
+#define PROF_NONE    PROF_NUM /* 計測しない (sched.h の表で使う) */
+
+#ifdef PROFILE
+
+/* ITU ch1 の 16CNT (16ビットで一度に読む) */
+#define PROF_NOW() (*(volatile unsigned short *)&T16TCNT1H)
+
+extern volatile unsigned short prof_start[PROF_NUM];
+
+#define PROF_BEGIN(n) (prof_start[n] = PROF_NOW())
+#define PROF_END(n)   prof_end((n), (unsigned short)(PROF_NOW() - prof_start[n]))
+
+extern void prof_init(void);
+     /* 計測用タイマを起動し, 集計をクリアする */
+extern void prof_end(int n, unsigned short t);
+     /* 段 n の実行時間 t(φ単位)を集計する (割り込みハンドラから呼ぶ) */
+extern void prof_reset(void);
+     /* 集計をクリアする */
+extern void prof_lcd(int n);
+     /* 段 n の平均と最大[us], 超過回数を LCD の MENU_STATUS 画面に表示する */
+extern void prof_report(void);
+     /* 全ての段の集計を SCI2 に送信する (メインループから呼ぶ) */
+
+#else
+
+#define PROF_BEGIN(n)
+#define PROF_END(n)
+
+#endif
@@ -1,5 +1,6 @@
 /*   H8/3069版 ROM化用のスタートアップルーチン (2009/5/1 和崎) */
 /*   .bss領域の 0 クリアはしない                               */
+/*   .fast領域は実行するアドレスにロードされるので転送しない   */
 	.h8300h
 	.section .text
 	.global _start
@@ -1,5 +1,6 @@
 /*   H8/3069版 ROM化用のスタートアップルーチン (2009/5/1 和崎) */
 /*   .bss領域の 0 クリアはしない                               */
+/*   .fast領域は外部RAMから内蔵RAMに転送する                   */
 	.h8300h
 	.section .text
 	.global _start
@@ -10,6 +11,22 @@
 _start:
 /* 外部RAM上にスタックポインタをセット */
 	mov.l   #__ext_stack, sp    /* 外部RAM：0x600000(CS2の終わり+1) */
+/* .fast領域(割り込み処理のコードと変数)の内蔵RAMへの転送 */
+/*   er0：.fast領域の先頭アドレス (内蔵RAM, コピー先のポインタ) */
+/*   er1：.fast領域の終了アドレス+1 */
+/*   er2：.fast領域の外部RAM内配置アドレス (コピー元のポインタ) */
+/*   r3h：コピー用のテンポラリ */
+__fast_copy:
+	mov.l	#__fast_start,er0
+	mov.l	#__fast_end,er1
+	mov.l	#__ifast_start,er2
+__loop_fast:
+	cmp.l	er0,er1		/* er1 - er0 を計算する */
+	ble	__go_main	/* er1 <= er0 なら転送終了 */ 
+	mov.b	@er2+,r3h	/* 外部RAMからデータ読み出し 元ポインタ +1 */
+	mov.b	r3h,@er0	/* データを内蔵RAMに */
+	inc.l	#1,er0		/* コピー先のポインタ +1 */
+	bra	__loop_fast	
 /* main()を呼び出す */
 /*   実行が終了したらスリープ状態になる */
 __go_main:
@@ -0,0 +1,67 @@
+// 書き手と読み手が1つずつのリングバッファ (全てマクロ)
+//
+// 大きさは2のべき乗で, 添字は書き込んだ数 head をマスクして求める (剰余なし)
+// head は書き手だけが, tail は読み手だけが進める. 書き手は要素を書き終えて
+// から head を進める(公開する)ので, 割り込みハンドラが書き手でメインループ
+// が読み手でも, 割り込みを禁止せずに書き終わった要素だけが読める
+//   head, tail は16ビットなので H8/300H では1命令で読み書きされる
+//   要素と head, tail は volatile なので, コンパイラは要素の書き込みと
+//   head を進める順を入れ替えない (H8 にはメモリアクセスの並べ替えはない)
+//
+// 使い方は2通り
+//   最新の n 個(窓)を読む : 書き手は ring_put() で一番古い要素を上書きし,
+//     読み手は ring_last() で i 個前の要素を読む (読んでも消費しない)
+//     何個かを続けて読むときは h = ring_head() を1回読んで ring_at() を使う
+//     (読んでいる間に書き手が大きさ - n 回以上書くと窓がずれる)
+//   順に取り出す(キュー) : 書き手は ring_full() でなければ ring_put() し,
+//     読み手は ring_empty() でなければ ring_front() を読んで ring_pop() する
+//
+// 例  RING(unsigned short, 16) buf;     (大きさが2のべき乗でなければエラー)
+//     ring_init(&buf);
+//     ring_put(&buf, v);                 (割り込みハンドラ)
+//     x = ring_last(&buf, 0);            (メインループ, 最新の値)
+//
+// DMAC など, 書き手がハードウェアで書き込み位置をレジスタから求めるものは
+// 構造体にできないので, 添字の計算だけ ring_wrap() を使う
+
+#define RING(type, size)                                              \
+  struct {                                                            \
+    volatile unsigned short head;  /* 書き込んだ数 */                 \
+    volatile unsigned short tail;  /* 取り出した数 (キューのとき) */  \
+    unsigned int : (((size) & ((size) - 1)) == 0) ? 0 : -1;          \
+    volatile type buf[size];                                          \
+  }
+     /* 要素の型 type, 大きさ size のリングバッファの型 */
+
+#define ring_size(r)  (sizeof((r)->buf) / sizeof((r)->buf[0]))
+#define ring_wrap(size, i) ((i) & ((size) - 1))
+     /* 大きさ size のリングバッファの添字 i (負でも良い) */
+
+#define ring_init(r)  ((r)->head = (r)->tail = 0)
+     /* 空にする (書き手と読み手が動いていないときに呼ぶ) */
+#define ring_count(r) ((unsigned short)((r)->head - (r)->tail))
+     /* キューに入っている要素の数 */
+#define ring_empty(r) ((r)->head == (r)->tail)
+#define ring_full(r)  (ring_count(r) >= ring_size(r))
+
+/* 書き手 */
+#define ring_slot(r)    ((r)->buf[ring_wrap(ring_size(r), (r)->head)])
+     /* 次に書く要素 (ring_publish() するまで読み手からは見えない) */
+#define ring_publish(r) ((r)->head++)
+     /* ring_slot() に書いた要素を公開する */
+#define ring_put(r, v)  (ring_slot(r) = (v), ring_publish(r))
+     /* 要素 v を書いて公開する (窓のときは一番古い要素を上書きする) */
+
+/* 読み手 (窓) */
+#define ring_head(r)     ((r)->head)
+     /* 書き込んだ数 (続けて読むときに1回だけ読んで ring_at() に渡す) */
+#define ring_at(r, h, i) ((r)->buf[ring_wrap(ring_size(r), (h) - 1 - (i))])
+     /* 書き込んだ数が h のときの i 個前の要素 (0 が最新) */
+#define ring_last(r, i)  ring_at(r, ring_head(r), i)
+     /* 最新から i 個前の要素 (i は大きさ - 1 まで) */
+
+/* 読み手 (キュー) */
+#define ring_front(r) ((r)->buf[ring_wrap(ring_size(r), (r)->tail)])
+     /* 一番古い要素 (空でないことを確かめてから読む) */
+#define ring_pop(r)   ((r)->tail++)
+     /* ring_front() を読み終えたら進める */
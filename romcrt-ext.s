@@ -1,5 +1,6 @@
 /*   H8/3069版 ROM化用のスタートアップルーチン (2009/5/1 和崎) */
 /*   RAM版と異なるのは、.data領域を初期化すること              */
+/*   .fast領域は内蔵ROMから内蔵RAMに転送する                   */
 /*   .bss領域の 0 クリアはしない                               */
 	.h8300h
 	.section .text
@@ -83,11 +84,27 @@ __pon_wait:
 	mov.l	#__idata_start,er2
 __loop_copy:
 	cmp.l	er0,er1		/* er1 - er0 を計算する */
-	ble	__go_main	/* er1 <= er0 なら初期化終了 */ 
+	ble	__fast_copy	/* er1 <= er0 なら初期化終了 */ 
 	mov.b	@er2+,r3h	/* ROM領域からデータ読み出し 元ポインタ +1 */
 	mov.b	r3h,@er0	/* データをコピー先に */
 	inc.l	#1,er0		/* コピー先のポインタ +1 */
 	bra	__loop_copy	
+/* .fast領域(割り込み処理のコードと変数)の内蔵RAMへの転送 */
+/*   er0：.fast領域の先頭アドレス (内蔵RAM, コピー先のポインタ) */
+/*   er1：.fast領域の終了アドレス+1 */
+/*   er2：.fast領域のROM内配置アドレス (コピー元のポインタ) */
+/*   r3h：コピー用のテンポラリ */
+__fast_copy:
+	mov.l	#__fast_start,er0
+	mov.l	#__fast_end,er1
+	mov.l	#__ifast_start,er2
+__loop_fast:
+	cmp.l	er0,er1		/* er1 - er0 を計算する */
+	ble	__go_main	/* er1 <= er0 なら転送終了 */ 
+	mov.b	@er2+,r3h	/* ROM領域からデータ読み出し 元ポインタ +1 */
+	mov.b	r3h,@er0	/* データを内蔵RAMに */
+	inc.l	#1,er0		/* コピー先のポインタ +1 */
+	bra	__loop_fast	
 /* main()を呼び出す */
 /*   実行が終了したらスリープ状態になる */
 __go_main:
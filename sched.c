@@ -0,0 +1,230 @@
+#include "h8-3069-iodef.h"
+#include "intr.h"
+#include "profile.h"
+#include "fastram.h"
+#include "sched.h"
+
+/* ITU ch0 の 16CNT (割り込みの周期の初めからの時間) */
+#ifdef H8SIM
+#define SCHED_NOW() ((unsigned short)((T16TCNT0H << 8) | T16TCNT0L))
+#else
+#define SCHED_NOW() (*(volatile unsigned short *)&T16TCNT0H)
+#endif
+/* TISRA の IMFA0 (GRA0 のコンペアマッチで 1, int_imia0 がクリアする) */
+#define SCHED_IMFA0 0x01
+
+/* 登録した表 */
+static const struct sched_task *sched_table FASTDATA;
+static int sched_num FASTDATA;
+
+/* 処理ごとの次に呼ぶまでの割り込みの回数, 予算[カウント], 集計 */
+static unsigned char sched_wait[SCHED_MAX] FASTDATA;
+static unsigned short sched_budget[SCHED_MAX] FASTDATA;
+static volatile struct sched_stat sched_stat[SCHED_MAX] FASTDATA;
+
+/* 割り込みの周期[カウント], [us]と, ヒストグラムの各段の上限[カウント] */
+static unsigned short sched_period FASTDATA;
+static unsigned int sched_tick_us FASTDATA;
+static unsigned short sched_histlim[SCHED_HISTNUM] FASTDATA;
+
+/* 1カウントの時間 [us] x 2^SCHED_USSHIFT (sched_time() で除算をしないため) */
+#define SCHED_USSHIFT 16
+static unsigned long sched_count_us FASTDATA;
+
+/* 負荷のヒストグラム, 最大の負荷[カウント], 周期を越えた回数 */
+static volatile unsigned long sched_histcnt[SCHED_HISTNUM] FASTDATA;
+static volatile unsigned short sched_peak FASTDATA;
+static volatile unsigned long sched_over FASTDATA;
+
+/* sched_tick() を呼んだ回数 (sched_time() の時刻) */
+static volatile unsigned long sched_ticks FASTDATA;
+
+void sched_init(const struct sched_task *table, int num, unsigned int tick_us);
+void sched_tick(void) FASTCODE;
+void sched_reset(void);
+void sched_get(int n, struct sched_stat *s);
+void sched_hist(unsigned long *h);
+int sched_load(void);
+int sched_percent(unsigned long count);
+unsigned long sched_tickover(void);
+unsigned long sched_time(void) FASTCODE;
+
+static void sched_clear(void)
+     /* 集計をクリアする関数 */
+{
+  int n;
+
+  for (n = 0; n < SCHED_MAX; n++) {
+    sched_stat[n].max = 0;
+    sched_stat[n].count = 0;
+    sched_stat[n].overrun = 0;
+  }
+  for (n = 0; n < SCHED_HISTNUM; n++) sched_histcnt[n] = 0;
+  sched_peak = 0;
+  sched_over = 0;
+}
+
+void sched_init(const struct sched_task *table, int num, unsigned int tick_us)
+     /* 表を登録する関数                                         */
+     /* 予算とヒストグラムの段の境目, 1カウントの時間は, ここで     */
+     /* 求めておく (割り込み処理の中では除算をしない)              */
+{
+  unsigned long period;
+  int n;
+
+  if (num > SCHED_MAX) num = SCHED_MAX;
+  period = ((GRA0H << 8) | GRA0L) + 1;
+  sched_period = period;
+  sched_tick_us = tick_us;
+  sched_count_us = ((unsigned long)tick_us << SCHED_USSHIFT) / period;
+  sched_ticks = 0;
+  for (n = 0; n < SCHED_HISTNUM; n++) {
+    sched_histlim[n] = period * (n + 1) / SCHED_HISTNUM;
+  }
+  for (n = 0; n < num; n++) {
+    sched_wait[n] = table[n].phase;
+    sched_budget[n] = (unsigned long)table[n].budget * period / tick_us;
+  }
+  sched_clear();
+  sched_table = table;
+  sched_num = num;
+}
+
+void sched_tick(void)
+     /* 今の割り込みで呼ぶ処理を表の順に呼び出す関数               */
+     /* 処理ごとに次に呼ぶまでの回数を数え下げるので, 剰余は使わない */
+     /* 最後に周期の初めからの時間を負荷としてヒストグラムに入れる   */
+{
+  const struct sched_task *t;
+  volatile struct sched_stat *s;
+  unsigned short start, begin, end, dt;
+  int n;
+
+  start = SCHED_NOW();
+  sched_ticks++;
+  for (n = 0; n < sched_num; n++) {
+    t = &sched_table[n];
+    if (t->period == 0) continue;
+    if (sched_wait[n] != 0) {
+      sched_wait[n]--;
+      continue;
+    }
+    sched_wait[n] = t->period - 1;
+
+#ifdef PROFILE
+    if (t->prof != PROF_NONE) PROF_BEGIN(t->prof);
+#endif
+    begin = SCHED_NOW();
+    t->func();
+    end = SCHED_NOW();
+#ifdef PROFILE
+    if (t->prof != PROF_NONE) PROF_END(t->prof);
+#endif
+
+    /* カウンタが周期の終わりで 0 に戻っていたら1周期分足す */
+    dt = (end >= begin) ? end - begin : end + sched_period - begin;
+    s = &sched_stat[n];
+    s->count++;
+    if (dt > s->max) s->max = dt;
+    if (dt > sched_budget[n]) s->overrun++;
+  }
+
+  end = SCHED_NOW();
+  if (end < start) {           /* 次の割り込みの周期に入ってしまった */
+    sched_over++;
+    sched_histcnt[SCHED_HISTNUM - 1]++;
+    sched_peak = sched_period;
+    return;
+  }
+  if (end > sched_peak) sched_peak = end;
+  for (n = 0; n < SCHED_HISTNUM - 1 && end >= sched_histlim[n]; n++)
+    ;
+  sched_histcnt[n]++;
+}
+
+void sched_reset(void)
+     /* 集計をクリアする関数 (メインループから呼ぶ) */
+{
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  sched_clear();
+  INTR_UNLOCK(lock);
+}
+
+void sched_get(int n, struct sched_stat *s)
+     /* 表の n 行目の集計を割り込みを禁止して読み出す関数 */
+{
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  s->max = sched_stat[n].max;
+  s->count = sched_stat[n].count;
+  s->overrun = sched_stat[n].overrun;
+  INTR_UNLOCK(lock);
+}
+
+void sched_hist(unsigned long *h)
+     /* 負荷のヒストグラムを割り込みを禁止して読み出す関数 */
+{
+  int n;
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  for (n = 0; n < SCHED_HISTNUM; n++) h[n] = sched_histcnt[n];
+  INTR_UNLOCK(lock);
+}
+
+int sched_load(void)
+     /* 最大の負荷を周期に対する % で返す関数 */
+{
+  unsigned long peak;
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  peak = sched_peak;
+  INTR_UNLOCK(lock);
+  return sched_percent(peak);
+}
+
+int sched_percent(unsigned long count)
+     /* カウント数を周期に対する % にする関数 (除算があるのでメインループ用) */
+{
+  return (sched_period == 0) ? 0 : count * 100 / sched_period;
+}
+
+unsigned long sched_tickover(void)
+     /* 周期を越えた回数を返す関数 */
+{
+  unsigned long over;
+  unsigned char lock;
+
+  INTR_LOCK0(lock);
+  over = sched_over;
+  INTR_UNLOCK(lock);
+  return over;
+}
+
+unsigned long sched_time(void)
+     /* タイマを動かしてからの時間[us] を返す関数                   */
+     /* 読んでいる間に割り込みが入って回数が変わったら読み直す       */
+     /* カウンタが 0 に戻ったのに int_imia0 がまだ実行されていない   */
+     /* (割り込みの禁止中や割り込みハンドラの中)ときは, IMFA0 が 1 で */
+     /* カウンタが周期の前半にあるので, まだ数えていない1周期を足す   */
+     /* (カウンタを先に読むので, 読む間に 0 に戻っても前半にはならない) */
+     /* 周期の中の時間は sched_init() で求めた1カウントの時間を掛けて */
+     /* 求める (除算はしない. 除算で求めるより最大 1us 小さい)        */
+     /*   cnt < 周期なので, 積は tick_us x 2^SCHED_USSHIFT 未満        */
+{
+  unsigned long ticks;
+  unsigned short cnt;
+  unsigned char pend;
+
+  do {
+    ticks = sched_ticks;
+    cnt = SCHED_NOW();
+    pend = TISRA & SCHED_IMFA0;
+  } while (ticks != sched_ticks);
+  if (pend && (cnt < (sched_period >> 1))) ticks++;
+  return ticks * sched_tick_us + (((unsigned long)cnt * sched_count_us) >> SCHED_USSHIFT);
+}
@@ -0,0 +1,59 @@
+// sched.c を利用するために必要なヘッダファイル
+// タイマ割り込みで周期的に呼び出す処理の表 (マルチレートのスケジューラ)
+//
+// 各処理は周期 period と位相 phase [割り込みの回数] をもち, 割り込みの
+// 通し番号が phase, phase+period, phase+2*period, ... のときに呼ばれる
+// 同じ周期の処理の位相をずらしておけば, 1回の割り込みに処理が重ならず,
+// 最悪の割り込みの実行時間が短くなる. 同じ割り込みで呼ぶ処理は表の順
+// 周期的な処理を増やすときは, 表に行を足すだけで良い
+//
+// 処理ごとに最大の実行時間と予算を越えた回数, 割り込みごとに周期に対する
+// 負荷のヒストグラムを数える. 時間は割り込みを起こしている ITU ch0 の
+// カウンタ(GRA0 のコンペアマッチで 0 に戻る)を読むので, 他のタイマは使わない
+
+#define SCHED_MAX     8      /* 表に書ける処理の数 */
+#define SCHED_HISTNUM 8      /* 負荷のヒストグラムの段数 (1段が周期の 1/8) */
+
+/* 表の1行 */
+struct sched_task {
+  void (*func)(void);        /* 呼び出す関数 */
+  unsigned char period;      /* 周期 [割り込みの回数] (0 なら呼ばない) */
+  unsigned char phase;       /* 位相 [割り込みの回数] (0 - period-1) */
+  unsigned short budget;     /* 実行時間の予算 [us] */
+  unsigned char prof;        /* profile.h の計測の段 (PROF_NONE なら計測しない) */
+};
+
+/* 処理ごとの集計 */
+struct sched_stat {
+  unsigned short max;        /* 最大の実行時間 [ITU ch0 のカウント] */
+  unsigned long count;       /* 呼び出した回数 */
+  unsigned long overrun;     /* 予算を越えた回数 */
+};
+
+extern void sched_init(const struct sched_task *table, int num, unsigned int tick_us);
+     /* 表 table[0 - num-1] を登録し, 集計をクリアする             */
+     /* tick_us は割り込みの周期[us] (timer_set() の後に呼ぶこと)  */
+extern void sched_tick(void);
+     /* 今の割り込みで呼ぶ処理を表の順に呼び出す (割り込みハンドラから1回呼ぶ) */
+extern void sched_reset(void);
+     /* 集計をクリアする */
+extern void sched_get(int n, struct sched_stat *s);
+     /* 表の n 行目の処理の集計を読み出す */
+extern void sched_hist(unsigned long *h);
+     /* 負荷のヒストグラム h[0 - SCHED_HISTNUM-1] を読み出す            */
+     /*   h[i] は負荷が周期の i/8 以上 (i+1)/8 未満だった割り込みの回数 */
+     /*   (最後の段は周期を越えたものも含む)                          */
+extern int sched_load(void);
+     /* これまでで最大の負荷 [%] を返す (メインループから呼ぶ) */
+extern int sched_percent(unsigned long count);
+     /* ITU ch0 のカウント数(sched_stat の max など)を周期に対する % にする */
+extern unsigned long sched_tickover(void);
+     /* 処理が次の割り込みまでに終わらなかった回数を返す */
+extern unsigned long sched_time(void);
+     /* タイマを動かしてからの時間[us] を返す                              */
+     /* 除算を使わないので割り込みハンドラからも呼べる (sched_init() の後) */
+     /* 割り込みの回数と ITU ch0 のカウンタ, IMFA0 から求めるので, 割り込み */
+     /* を禁止して int_imia0 が半周期以上遅れると, 1周期分小さくなる       */
+     /* 割り込みハンドラの中では割り込みの回数は変わらない. int_imia0 が   */
+     /* IMFA0 をクリアしてから sched_tick() で回数を進めるまでの間に,      */
+     /* 入れ子の割り込みハンドラから呼ぶと1周期分小さくなる                */
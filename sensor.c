@@ -0,0 +1,119 @@
+#include "sensor.h"
+#include "fastram.h"
+
+/* 黒さの合計 c (2^SENSOR_RECIPBITS 以上 2^(SENSOR_RECIPBITS+1) 未満に */
+/* 正規化したもの)の逆数 2^SENSOR_RECIPSHIFT / c の表                  */
+#define SENSOR_RECIPNUM (1 << SENSOR_RECIPBITS)
+static unsigned short sensor_recip[SENSOR_RECIPNUM] FASTDATA;
+
+void sensor_init(struct sensor_array *s, int num, const unsigned char *ch,
+                 const short *pos, int white, int black);
+void sensor_cal(struct sensor_array *s, int i, int white, int black);
+void sensor_cal_white(struct sensor_array *s);
+void sensor_cal_black(struct sensor_array *s);
+void sensor_update(struct sensor_array *s, int (*read)(int ch)) FASTCODE;
+
+void sensor_init(struct sensor_array *s, int num, const unsigned char *ch,
+                 const short *pos, int white, int black)
+     /* センサアレイの初期化関数 */
+{
+  int i;
+
+  for (i = 0; i < SENSOR_RECIPNUM; i++) {
+    sensor_recip[i] = (1UL << SENSOR_RECIPSHIFT) / (SENSOR_RECIPNUM + i);
+  }
+  if (num > SENSOR_MAX) num = SENSOR_MAX;
+  s->num = num;
+  s->ch = ch;
+  s->pos = pos;
+  for (i = 0; i < num; i++) {
+    s->raw[i] = white;
+    s->val[i] = 0;
+    sensor_cal(s, i, white, black);
+  }
+  s->line = 0;
+  s->conf = 0;
+}
+
+void sensor_cal(struct sensor_array *s, int i, int white, int black)
+     /* センサ i の校正関数                                         */
+     /* 白から黒までの 1/4 はノイズとみなして黒さ 0 とし, そこから   */
+     /* 黒までを 0-SENSOR_ONE に割り当てる                          */
+     /* 白と黒が逆や同じときは黒さを常に 0 にする                   */
+{
+  int zero;
+
+  s->white[i] = white;
+  s->black[i] = black;
+  zero = white + (black - white) / 4;
+  s->zero[i] = zero;
+  if (black > zero) {
+    s->gain[i] = ((long)SENSOR_ONE << SENSOR_GAINSHIFT) / (black - zero);
+  } else {
+    s->zero[i] = 0xffff;
+    s->gain[i] = 0;
+  }
+}
+
+void sensor_cal_white(struct sensor_array *s)
+     /* 今の値を白として校正する関数 (MENU_SETWHITE から呼ぶ) */
+{
+  int i;
+
+  for (i = 0; i < s->num; i++) sensor_cal(s, i, s->raw[i], s->black[i]);
+}
+
+void sensor_cal_black(struct sensor_array *s)
+     /* 今の値を黒として校正する関数 (MENU_SETBLACK から呼ぶ) */
+{
+  int i;
+
+  for (i = 0; i < s->num; i++) sensor_cal(s, i, s->white[i], s->raw[i]);
+}
+
+void sensor_update(struct sensor_array *s, int (*read)(int ch))
+     /* センサアレイを更新する関数                                      */
+     /* 割り込みハンドラから呼ばれるので除算は使わない                  */
+     /*   黒さ  val = (raw - zero) * gain (0-SENSOR_ONE に制限)          */
+     /*   位置  line = Σ val*pos / max(Σ val, SENSOR_ONE)               */
+     /*         Σ val > SENSOR_ONE のときは Σ val を k ビット右へずらして */
+     /*         上位 SENSOR_RECIPBITS+1 ビットにし, 逆数の表を掛けて     */
+     /*         SENSOR_RECIPSHIFT+k ビット戻す (誤差は 1% 以下)          */
+     /*   確からしさ conf = Σ val                                       */
+     /* 負の数を右へずらすと -∞ 側に丸められるので, 位置は絶対値で求めて */
+     /* から符号を戻す (除算と同じく 0 に向けて丸める)                  */
+     /* 黒さの合計が SENSOR_ONE に満たないとき(ラインが一部しか見えない) */
+     /* は SENSOR_ONE で割るので, 位置は見えている分に比例して 0 に近づく */
+     /* (2個のセンサの間が白いときにも位置が連続的に変わる)             */
+{
+  int i, v, k, neg;
+  long sum = 0;
+  long conf = 0;
+  long c;
+
+  for (i = 0; i < s->num; i++) {
+    v = read(s->ch[i]);
+    if (v < 0) v = 0;
+    s->raw[i] = v;
+    if (v <= s->zero[i]) {
+      v = 0;
+    } else {
+      v = ((long)(v - s->zero[i]) * s->gain[i]) >> SENSOR_GAINSHIFT;
+      if (v > SENSOR_ONE) v = SENSOR_ONE;
+    }
+    s->val[i] = v;
+    sum += (long)v * s->pos[i];
+    conf += v;
+  }
+  s->conf = conf;
+  neg = (sum < 0);
+  if (neg) sum = -sum;
+  if (conf > SENSOR_ONE) {
+    c = conf;
+    for (k = 0; c >= 2 * SENSOR_RECIPNUM; k++) c >>= 1;  /* SENSOR_MAX 個でも4回以下 */
+    sum = (sum * sensor_recip[c - SENSOR_RECIPNUM]) >> (SENSOR_RECIPSHIFT + k);
+  } else {
+    sum >>= SENSOR_ONESHIFT;
+  }
+  s->line = neg ? -sum : sum;
+}
@@ -0,0 +1,44 @@
+// sensor.c を利用するために必要なヘッダファイル
+// ライン検出用の光センサを並べたセンサアレイ (最大 SENSOR_MAX 個)
+//
+// センサごとに A/D のチャネルとロボットの中心線からの位置を設定表で与え,
+// 白と黒のレベルで校正して黒さを 0-SENSOR_ONE に正規化し,
+// 位置の重み付き平均(重心)でラインの位置を, 黒さの合計で確からしさを求める
+// センサを増やすときは設定表(チャネルと位置)に行を足すだけで良い
+// 1回の更新はセンサ1個あたり定数時間で, 正規化は乗算とシフトだけで行う
+// 重心の割り算は初期化のときに作る逆数の表を掛けて求める (除算は使わない)
+
+#define SENSOR_MAX 8         /* センサの最大個数 */
+#define SENSOR_ONESHIFT 8
+#define SENSOR_ONE (1 << SENSOR_ONESHIFT) /* 真っ黒のときの正規化した黒さ */
+#define SENSOR_GAINSHIFT 8   /* gain の小数部のビット数 */
+#define SENSOR_RECIPBITS 7   /* 逆数の表を引く黒さの合計の上位ビット数 */
+#define SENSOR_RECIPSHIFT 16 /* 逆数の表の小数部のビット数 */
+
+struct sensor_array {
+  int num;                                 /* センサの個数 */
+  const unsigned char *ch;                 /* A/D のチャネル (設定表) */
+  const short *pos;                        /* 位置[1/8 mm] (設定表, AN1 側が正, */
+                                           /* 重心の計算があふれないよう ±1000 以内) */
+  unsigned short white[SENSOR_MAX];        /* 校正した白のレベル */
+  unsigned short black[SENSOR_MAX];        /* 校正した黒のレベル */
+  unsigned short zero[SENSOR_MAX];         /* 黒さを 0 とするレベル */
+  unsigned short gain[SENSOR_MAX];         /* 黒さへの換算係数 x 2^SENSOR_GAINSHIFT */
+  unsigned short raw[SENSOR_MAX];          /* A/D の値 */
+  unsigned short val[SENSOR_MAX];          /* 正規化した黒さ (0-SENSOR_ONE) */
+  int line;                                /* ラインの位置[1/8 mm] */
+  int conf;                                /* 確からしさ (黒さの合計) */
+};
+
+extern void sensor_init(struct sensor_array *s, int num, const unsigned char *ch,
+                        const short *pos, int white, int black);
+     /* 設定表を登録し, 全てのセンサを同じ白と黒のレベルで校正する */
+extern void sensor_cal(struct sensor_array *s, int i, int white, int black);
+     /* センサ i を白と黒のレベルで校正する (除算を使うのでメインループで呼ぶ) */
+extern void sensor_cal_white(struct sensor_array *s);
+     /* 全てのセンサの今の値を白のレベルとして校正し直す */
+extern void sensor_cal_black(struct sensor_array *s);
+     /* 全てのセンサの今の値を黒のレベルとして校正し直す */
+extern void sensor_update(struct sensor_array *s, int (*read)(int ch));
+     /* read(チャネル) で全てのセンサの値を読み, 黒さ, 位置, 確からしさを求める */
+     /* 1制御周期に1回呼ぶ                                                     */
@@ -0,0 +1,47 @@
+#include "seqlock.h"
+#include "fastram.h"
+
+void seq_read(struct seqlock *l, void *dst, const void *src, int size);
+int seq_fetch(struct seqlock *l, unsigned short *seen, void *dst,
+              const void *src, int size) FASTCODE;
+static void seq_copy(void *dst, const void *src, int size) FASTCODE;
+
+static void seq_copy(void *dst, const void *src, int size)
+     /* size バイトをコピーする関数 (受け渡す構造体は数十バイト) */
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+
+  while (size-- > 0) *d++ = *s++;
+}
+
+void seq_read(struct seqlock *l, void *dst, const void *src, int size)
+     /* 書き手に割り込まれる側(メインループ)が読む関数              */
+     /* 書き手は割り込みハンドラで最後まで書いてから戻るので,        */
+     /* seq が奇数のまま待つことはなく, 変わっていたらコピーし直す   */
+{
+  unsigned short s;
+
+  do {
+    while ((s = l->seq) & 1)
+      ;
+    SEQ_BARRIER();
+    seq_copy(dst, src, size);
+    SEQ_BARRIER();
+  } while (l->seq != s);
+}
+
+int seq_fetch(struct seqlock *l, unsigned short *seen, void *dst,
+              const void *src, int size)
+     /* 書き手を中断している側(割り込みハンドラ)が読む関数        */
+     /* 読んでいる間に書き手は動かないので, 前後の比較は要らない   */
+{
+  unsigned short s;
+
+  s = l->seq;
+  if ((s & 1) || (s == *seen)) return 0;
+  SEQ_BARRIER();
+  seq_copy(dst, src, size);
+  *seen = s;
+  return 1;
+}
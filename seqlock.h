@@ -0,0 +1,38 @@
+// seqlock.c を利用するために必要なヘッダファイル
+// 割り込みハンドラとメインループの間で構造体を丸ごと受け渡す (シーケンスロック)
+//
+// 書き手は書き始めと書き終わりに通し番号 seq を 1 ずつ進めるので, seq が
+// 奇数の間は書いている途中になる. 読み手はコピーの前後で seq が同じ偶数なら,
+// 途中で書き換えられていない組をコピーできている. 割り込みは禁止しない
+//   割り込みハンドラ → メインループ : 割り込みハンドラが seq_write_begin(),
+//     seq_write_end() で囲んで書き, メインループが seq_read() で読む
+//     コピーの途中で割り込まれたらコピーし直す (割り込みは1周期に1回なので,
+//     数十バイトのコピーならやり直しはまれで, 続けてやり直すことはない)
+//   メインループ → 割り込みハンドラ : メインループが同じように書き,
+//     割り込みハンドラが seq_fetch() で新しく書かれたときだけ読む
+//     割り込みハンドラは書き手を中断しているので待たずに戻り,
+//     書いている途中なら次の割り込みで読む
+// 書き手と読み手はそれぞれ1つだけにすること
+
+/* コンパイラがメモリの読み書きを前後に動かさないようにする */
+/* (H8 はメモリアクセスの順を入れ替えないので命令は要らない) */
+#define SEQ_BARRIER() asm volatile ("" : : : "memory")
+
+struct seqlock {
+  volatile unsigned short seq;   /* 書いた回数 x 2 (奇数なら書いている途中) */
+};
+
+#define seq_init(l) ((l)->seq = 0)
+#define seq_write_begin(l) do { (l)->seq++; SEQ_BARRIER(); } while (0)
+     /* 書き始める (seq が奇数になる) */
+#define seq_write_end(l) do { SEQ_BARRIER(); (l)->seq++; } while (0)
+     /* 書き終わる (seq が偶数になり, 読み手に見える) */
+
+extern void seq_read(struct seqlock *l, void *dst, const void *src, int size);
+     /* 書き手(割り込みハンドラ)が書き換えていない src の size バイトを  */
+     /* dst にコピーする (メインループから呼ぶ)                          */
+extern int seq_fetch(struct seqlock *l, unsigned short *seen, void *dst,
+                     const void *src, int size);
+     /* 前回読んだ後(seq が *seen と違う)に書き終わっていれば src を dst に */
+     /* コピーして 1 を返す. 新しくないか書いている途中なら 0 を返す        */
+     /* (割り込みハンドラから呼ぶ. *seen は 0 にしてから使う)               */
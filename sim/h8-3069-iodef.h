@@ -0,0 +1,442 @@
+/* sim/h8-3069-iodef.h */
+/* ホスト(Linux)上のシミュレータ用 H8/3069 レジスタ定義 */
+/*   h8-3069-iodef.h と同じ名前で各レジスタを定義するが,          */
+/*   実アドレスではなく h8sim_io[] の下位16ビットアドレスに割り当てる */
+/*   (内蔵I/Oは 0xfee000-0xfee0ff, 0xffff20-0xffffff なので衝突しない) */
+/*   ルートの h8-3069-iodef.h から H8SIM 定義時にだけ読み込まれる  */
+/*   レジスタの値の変化(A/D変換終了など)は sim/sim.c が模擬する     */
+
+extern volatile unsigned char h8sim_io[0x10000];
+#define H8SIM_IOREG(adr) (h8sim_io[(adr) & 0xffff])
+
+/* h8-3069-iodef.h */
+/* H8300Hシリーズ3064の各レジスタ群の定義 */
+
+/*   putbyte, getbyte を使わなくてよい定義の仕方 */
+/*     例：P1DDR = a; a = P1DR; のように使える */ 
+/*   (putbyte, getbyte を使う場合は h8-3069.h を使用すること) */
+/*   頻繁にI/Oアクセスする場合はこちらの方が効率がよい */
+
+/*   設定の詳細はPDFマニュアル(h83069)参照のこと */
+/*   作成2006年10月19日 和崎 */
+
+/* タイマ関係で数字から始まるレジスタのdefineはできない */
+/* 対策として、最初に"T"を付加しているので注意!!        */
+/* ［例］ 16TCR0 => T16TCR0                             */
+
+/* モードコントロールレジスタ */
+#define MDCR H8SIM_IOREG(0xfee011)
+/* システムコントロールレジスタ */
+#define SYSCR H8SIM_IOREG(0xfee012)
+
+/* 内蔵ROM関連 */
+/* フラッシュメモリコントロールレジスタ1 */
+#define FLMCR1 H8SIM_IOREG(0xfee030)
+/* フラッシュメモリコントロールレジスタ2 */
+#define FLMCR2 H8SIM_IOREG(0xfee031)
+/* 消去ブロック指定レジスタ1 */
+#define EBR1 H8SIM_IOREG(0xfee032)
+/* 消去ブロック指定レジスタ2 */
+#define EBR2 H8SIM_IOREG(0xfee033)
+/* RAMコントロールレジスタ */
+#define RAMCR H8SIM_IOREG(0xfee077)
+
+/* 低消費電力状態関連 */
+/* システムコントロールレジスタ */
+/* #define SYSCR (*(volatile unsigned char *)0xfee012 */
+/* モジュールスタンバイコントロールレジスタH */
+#define MSTCRH H8SIM_IOREG(0xfee01c)
+/* モジュールスタンバイコントロールレジスタL */
+#define MSTCRL H8SIM_IOREG(0xfee01d)
+
+/* IRQ関連 */
+/* IRQセンスコントロールレジスタ */
+#define ISCR H8SIM_IOREG(0xfee014)
+/* IRQイネーブルレジスタ */
+#define IER H8SIM_IOREG(0xfee015)
+/* IRQステータスレジスタ */
+#define ISR H8SIM_IOREG(0xfee016)
+/* インタラプト・プライオリティレジスタA */
+#define IPRA H8SIM_IOREG(0xfee018)
+/* インタラプト・プライオリティレジスタB */
+#define IPRB H8SIM_IOREG(0xfee019)
+
+/* バスコントロール関連 */
+/* バス幅コントロールレジスタ */
+#define ABWCR H8SIM_IOREG(0xfee020)
+/* アクセスステートコントロールレジスタ */
+#define ASTCR H8SIM_IOREG(0xfee021)
+/* ウェイトコントロールレジスタH */
+#define WCRH H8SIM_IOREG(0xfee022)
+/* ウェイトコントロールレジスタL */
+#define WCRL H8SIM_IOREG(0xfee023)
+/* バスリリースコントロールレジスタ */
+#define BRCR H8SIM_IOREG(0xfee013)
+/* チップセレクトコントロールレジスタ */
+#define CSCR H8SIM_IOREG(0xfee01f)
+/* アドレスコントロールレジスタ */
+#define ADRCR H8SIM_IOREG(0xfee01e)
+/* バスコントロールレジスタ */
+#define BCR H8SIM_IOREG(0xfee024)
+/* D-RAM制御は3069にはあるが3064にはない機能 */
+/* D-RAMコントロールレジスタ A */
+#define DRCRA H8SIM_IOREG(0xfee026)
+/* D-RAMコントロールレジスタ B */
+#define DRCRB H8SIM_IOREG(0xfee027)
+/* リフレッシュタイマコントロール・ステータスレジスタ */
+#define RTMCSR H8SIM_IOREG(0xfee028)
+/* リフレッシュタイマカウンタ */
+#define RTCNT H8SIM_IOREG(0xfee029)
+/* リフレッシュタイムコンスタントレジスタ */
+#define RTCOR H8SIM_IOREG(0xfee02A)
+
+/* DMAコントローラは3069にはあるが3064にはない機能 */
+/* DMAコントローラ関連 */
+/* チャネル 0 */
+/* メモリアドレスレジスタ0AR */
+#define MAR0AR H8SIM_IOREG(0xffff20)
+/* メモリアドレスレジスタ0AE */
+#define MAR0AE H8SIM_IOREG(0xffff21)
+/* メモリアドレスレジスタ0AH */
+#define MAR0AH H8SIM_IOREG(0xffff22)
+/* メモリアドレスレジスタ0AL */
+#define MAR0AL H8SIM_IOREG(0xffff23)
+/* 転送カウントレジスタ0AH */
+#define ETCR0AH H8SIM_IOREG(0xffff24)
+/* 転送カウントレジスタ0AL */
+#define ETCR0AL H8SIM_IOREG(0xffff25)
+/* I/Oアドレスレジスタ0A */
+#define IOAR0A H8SIM_IOREG(0xffff26)
+/* データ転送制御レジスタ0A */
+#define DTCR0A H8SIM_IOREG(0xffff27)
+/* メモリアドレスレジスタ0BR */
+#define MAR0BR H8SIM_IOREG(0xffff28)
+/* メモリアドレスレジスタ0BE */
+#define MAR0BE H8SIM_IOREG(0xffff29)
+/* メモリアドレスレジスタ0BH */
+#define MAR0BH H8SIM_IOREG(0xffff2a)
+/* メモリアドレスレジスタ0BL */
+#define MAR0BL H8SIM_IOREG(0xffff2b)
+/* 転送カウントレジスタ0BH */
+#define ETCR0BH H8SIM_IOREG(0xffff2c)
+/* 転送カウントレジスタ0BL */
+#define ETCR0BL H8SIM_IOREG(0xffff2d)
+/* I/Oアドレスレジスタ0B */
+#define IOAR0B H8SIM_IOREG(0xffff2e)
+/* データ転送制御レジスタ0B */
+#define DTCR0B H8SIM_IOREG(0xffff2f)
+/* チャネル 1 */
+/* メモリアドレスレジスタ1AR */
+#define MAR1AR H8SIM_IOREG(0xffff30)
+/* メモリアドレスレジスタ1AE */
+#define MAR1AE H8SIM_IOREG(0xffff31)
+/* メモリアドレスレジスタ1AH */
+#define MAR1AH H8SIM_IOREG(0xffff32)
+/* メモリアドレスレジスタ1AL */
+#define MAR1AL H8SIM_IOREG(0xffff33)
+/* 転送カウントレジスタ1AH */
+#define ETCR1AH H8SIM_IOREG(0xffff34)
+/* 転送カウントレジスタ1AL */
+#define ETCR1AL H8SIM_IOREG(0xffff35)
+/* I/Oアドレスレジスタ1A */
+#define IOAR1A H8SIM_IOREG(0xffff36)
+/* データ転送制御レジスタ1A */
+#define DTCR1A H8SIM_IOREG(0xffff37)
+/* メモリアドレスレジスタ1BR */
+#define MAR1BR H8SIM_IOREG(0xffff38)
+/* メモリアドレスレジスタ1BE */
+#define MAR1BE H8SIM_IOREG(0xffff39)
+/* メモリアドレスレジスタ1BH */
+#define MAR1BH H8SIM_IOREG(0xffff3a)
+/* メモリアドレスレジスタ1BL */
+#define MAR1BL H8SIM_IOREG(0xffff3b)
+/* 転送カウントレジスタ1BH */
+#define ETCR1BH H8SIM_IOREG(0xffff3c)
+/* 転送カウントレジスタ1BL */
+#define ETCR1BL H8SIM_IOREG(0xffff3d)
+/* I/Oアドレスレジスタ1B */
+#define IOAR1B H8SIM_IOREG(0xffff3e)
+/* データ転送制御レジスタ1B */
+#define DTCR1B H8SIM_IOREG(0xffff3f)
+
+/* IOポート関連 */
+/* ポート１データディレクションレジスタ */
+#define P1DDR H8SIM_IOREG(0xfee000)
+/* ポート１データレジスタ */
+#define P1DR H8SIM_IOREG(0xffffd0)
+/* ポート２データディレクションレジスタ */
+#define P2DDR H8SIM_IOREG(0xfee001)
+/* ポート２データレジスタ */
+#define P2DR H8SIM_IOREG(0xffffd1)
+/* ポート２入力プルアップMOSコントロールレジスタ */
+#define P2PCR H8SIM_IOREG(0xfee03c)
+/* ポート３データディレクションレジスタ */
+#define P3DDR H8SIM_IOREG(0xfee002)
+/* ポート３データレジスタ */
+#define P3DR H8SIM_IOREG(0xffffd2)
+/* ポート４データディレクションレジスタ */
+#define P4DDR H8SIM_IOREG(0xfee003)
+/* ポート４データレジスタ */
+#define P4DR H8SIM_IOREG(0xffffd3)
+/* ポート４入力プルアップMOSコントロールレジスタ */
+#define P4PCR H8SIM_IOREG(0xfee03e)
+/* ポート５データディレクションレジスタ */
+#define P5DDR H8SIM_IOREG(0xfee004)
+/* ポート５データレジスタ */
+#define P5DR H8SIM_IOREG(0xffffd4)
+/* ポート５入力プルアップMOSコントロールレジスタ */
+#define P5PCR H8SIM_IOREG(0xfee03f)
+/* ポート６データディレクションレジスタ */
+#define P6DDR H8SIM_IOREG(0xfee005)
+/* ポート６データレジスタ */
+#define P6DR H8SIM_IOREG(0xffffd5)
+/* ポート７データレジスタ（入力のみ） */
+#define P7DR H8SIM_IOREG(0xffffd6)
+/* ポート８データディレクションレジスタ */
+#define P8DDR H8SIM_IOREG(0xfee007)
+/* ポート８データレジスタ（５ビット） */
+#define P8DR H8SIM_IOREG(0xffffd7)
+/* ポート９データディレクションレジスタ */
+#define P9DDR H8SIM_IOREG(0xfee008)
+/* ポート９データレジスタ（６ビット） */
+#define P9DR H8SIM_IOREG(0xffffd8)
+/* ポートAデータディレクションレジスタ */
+#define PADDR H8SIM_IOREG(0xfee009)
+/* ポートAデータレジスタ */
+#define PADR H8SIM_IOREG(0xffffd9)
+/* ポートBデータディレクションレジスタ */
+#define PBDDR H8SIM_IOREG(0xfee00A)
+/* ポートBデータレジスタ */
+#define PBDR H8SIM_IOREG(0xffffdA)
+
+/* １６ビットタイマ */
+/* チャネル共通 */
+/* タイマスタートレジスタ */
+#define TSTR H8SIM_IOREG(0xffff60)
+/* タイマシンクロレジスタ */
+#define TSNC H8SIM_IOREG(0xffff61)
+/* タイマモードレジスタ */
+#define TMDR H8SIM_IOREG(0xffff62)
+/* タイマアウトプットレベルセットレジスタ */
+#define TOLR H8SIM_IOREG(0xffff63)
+/* タイマインタラプトレベルセットレジスタA */
+#define TISRA H8SIM_IOREG(0xffff64)
+/* タイマインタラプトレベルセットレジスタB */
+#define TISRB H8SIM_IOREG(0xffff65)
+/* タイマインタラプトレベルセットレジスタC */
+#define TISRC H8SIM_IOREG(0xffff66)
+/* チャネル０ */
+/* タイマコントロールレジスタ０ */
+#define T16TCR0 H8SIM_IOREG(0xffff68)
+/* タイマI/Oコントロールレジスタ０ */
+#define TIOR0 H8SIM_IOREG(0xffff69)
+/* タイマカウンタ０H */
+#define T16TCNT0H H8SIM_IOREG(0xffff6A)
+/* タイマカウンタ０L */
+#define T16TCNT0L H8SIM_IOREG(0xffff6B)
+/* ジェネラルレジスタA0H */
+#define GRA0H H8SIM_IOREG(0xffff6c)
+/* ジェネラルレジスタA0L */
+#define GRA0L H8SIM_IOREG(0xffff6d)
+/* ジェネラルレジスタB0H */
+#define GRB0H H8SIM_IOREG(0xffff6e)
+/* ジェネラルレジスタB0L */
+#define GRB0L H8SIM_IOREG(0xffff6f)
+/* チャネル１ */
+/* タイマコントロールレジスタ１ */
+#define T16TCR1 H8SIM_IOREG(0xffff70)
+/* タイマI/Oコントロールレジスタ１ */
+#define TIOR1 H8SIM_IOREG(0xffff71)
+/* タイマカウンタ１H */
+#define T16TCNT1H H8SIM_IOREG(0xffff72)
+/* タイマカウンタ１L */
+#define T16TCNT1L H8SIM_IOREG(0xffff73)
+/* ジェネラルレジスタA1H */
+#define GRA1H H8SIM_IOREG(0xffff74)
+/* ジェネラルレジスタA1L */
+#define GRA1L H8SIM_IOREG(0xffff75)
+/* ジェネラルレジスタB1H */
+#define GRB1H H8SIM_IOREG(0xffff76)
+/* ジェネラルレジスタB1L */
+#define GRB1L H8SIM_IOREG(0xffff77)
+/* チャネル２ */
+/* タイマコントロールレジスタ２ */
+#define T16TCR2 H8SIM_IOREG(0xffff78)
+/* タイマI/Oコントロールレジスタ２ */
+#define TIOR2 H8SIM_IOREG(0xffff79)
+/* タイマカウンタ２H */
+#define T16TCNT2H H8SIM_IOREG(0xffff7A)
+/* タイマカウンタ２L */
+#define T16TCNT2L H8SIM_IOREG(0xffff7B)
+/* ジェネラルレジスタA2H */
+#define GRA2H H8SIM_IOREG(0xffff7c)
+/* ジェネラルレジスタA2L */
+#define GRA2L H8SIM_IOREG(0xffff7d)
+/* ジェネラルレジスタB2H */
+#define GRB2H H8SIM_IOREG(0xffff7e)
+/* ジェネラルレジスタB2L */
+#define GRB2L H8SIM_IOREG(0xffff7f)
+
+/* ８ビットタイマ関連 */
+/* チャネル0 */
+/* タイマコントロールレジスタ0 */
+#define T8TCR0  H8SIM_IOREG(0xffff80)
+/* タイマコントロール/ステータスレジスタ0 */
+#define T8TCSR0 H8SIM_IOREG(0xffff82)
+/* タイマコンスタントレジスタA0 */
+#define TCORA0 H8SIM_IOREG(0xffff84)
+/* タイマコンスタントレジスタB0 */
+#define TCORB0 H8SIM_IOREG(0xffff86)
+/* タイマカウンタ0 */
+#define T8TCNT0 H8SIM_IOREG(0xffff88)
+/* チャネル1 */
+/* タイマコントロールレジスタ1 */
+#define T8TCR1 H8SIM_IOREG(0xffff81)
+/* タイマコントロール/ステータスレジスタ1 */
+#define T8TCSR1 H8SIM_IOREG(0xffff83)
+/* タイマコンスタントレジスタA1 */
+#define TCORA1 H8SIM_IOREG(0xffff85)
+/* タイマコンスタントレジスタB1 */
+#define TCORB1 H8SIM_IOREG(0xffff87)
+/* タイマカウンタ1 */
+#define T8TCNT1 H8SIM_IOREG(0xffff89)
+/* チャネル2 */
+/* タイマコントロールレジスタ2 */
+#define T8TCR2 H8SIM_IOREG(0xffff90)
+/* タイマコントロール/ステータスレジスタ2 */
+#define T8TCSR2 H8SIM_IOREG(0xffff92)
+/* タイマコンスタントレジスタA2 */
+#define TCORA2 H8SIM_IOREG(0xffff94)
+/* タイマコンスタントレジスタB2 */
+#define TCORB2 H8SIM_IOREG(0xffff96)
+/* タイマカウンタ2 */
+#define T8TCNT2 H8SIM_IOREG(0xffff98)
+/* チャネル3 */
+/* タイマコントロールレジスタ3 */
+#define T8TCR3 H8SIM_IOREG(0xffff91)
+/* タイマコントロール/ステータスレジスタ3 */
+#define T8TCSR3 H8SIM_IOREG(0xffff93)
+/* タイマコンスタントレジスタA3 */
+#define TCORA3 H8SIM_IOREG(0xffff95)
+/* タイマコンスタントレジスタB3 */
+#define TCORB3 H8SIM_IOREG(0xffff97)
+/* タイマカウンタ3 */
+#define T8TCNT3 H8SIM_IOREG(0xffff99)
+
+/* プログラマブルタイミングパターンコントローラ関連 */
+/* ポートAデータディレクションレジスタ */
+/* #define PADDR H8SIM_IOREG(0xfee009) */
+/* ポートAデータレジスタ */
+/* #define PADR H8SIM_IOREG(0xffffd9) */
+/* ポートBデータディレクションレジスタ */
+/* #define PBDDR H8SIM_IOREG(0xfee00A) */
+/* ポートBデータレジスタ */
+/* #define PBDR H8SIM_IOREG(0xffffdA) */
+/* TPC出力モードレジスタ */
+#define TPMR H8SIM_IOREG(0xffffa0)
+/* TPC出力コントロールレジスタ */
+#define TPCR H8SIM_IOREG(0xffffa1)
+/* ネクストデータイネーブルレジスタB */
+#define NDERB H8SIM_IOREG(0xffffa2)
+/* ネクストデータイネーブルレジスタA */
+#define NDERA H8SIM_IOREG(0xffffa3)
+/* ネクストデータレジスタA */
+#define NDRA H8SIM_IOREG(0xffffa5)
+/* (出力トリガが異なるときグループ0に対応) */
+#define NDRA0 H8SIM_IOREG(0xffffa5)
+/* ネクストデータレジスタA(出力トリガが異なるときグループ1) */
+#define NDRA1 H8SIM_IOREG(0xffffa7)
+/* ネクストデータレジスタB */
+#define NDRB H8SIM_IOREG(0xffffa4)
+/* (出力トリガが異なるときグループ2に対応) */
+#define NDRB2 H8SIM_IOREG(0xffffa4)
+/* ネクストデータレジスタB(出力トリガが異なるときグループ3) */
+#define NDRB3 H8SIM_IOREG(0xffffa6)
+
+/* ウォッチドッグタイマ関連 */
+/* タイマコントロール/ステータスレジスタ */
+#define TCSR H8SIM_IOREG(0xffff8c)
+/* タイマカウンタ */
+#define TCNT H8SIM_IOREG(0xffff8d)
+/* リセットコントロール/ステータスレジスタ */
+#define RSTCSR H8SIM_IOREG(0xffff8e)
+
+/* シリアルコミュニケーションインターフェース 及び */
+/* スマートカードインターフェース関連 */
+/* チャネル0 */
+/* シリアルモードレジスタ */
+#define SMR0 H8SIM_IOREG(0xffffb0)
+/* ビットレートレジスタ */
+#define BRR0 H8SIM_IOREG(0xffffb1)
+/* シリアルコントロールレジスタ */
+#define SCR0 H8SIM_IOREG(0xffffb2)
+/* トランスミットデータレジスタ */
+#define TDR0 H8SIM_IOREG(0xffffb3)
+/* シリアルステータスレジスタ */
+#define SSR0 H8SIM_IOREG(0xffffb4)
+/* レシーブデータレジスタ */
+#define RDR0 H8SIM_IOREG(0xffffb5)
+/* スマートカードモードレジスタ */
+#define SCMR0 H8SIM_IOREG(0xffffb6)
+/* チャネル1 */
+/* シリアルモードレジスタ */
+#define SMR1 H8SIM_IOREG(0xffffb8)
+/* ビットレートレジスタ */
+#define BRR1 H8SIM_IOREG(0xffffb9)
+/* シリアルコントロールレジスタ */
+#define SCR1 H8SIM_IOREG(0xffffba)
+/* トランスミットデータレジスタ */
+#define TDR1 H8SIM_IOREG(0xffffbb)
+/* シリアルステータスレジスタ */
+#define SSR1 H8SIM_IOREG(0xffffbc)
+/* レシーブデータレジスタ */
+#define RDR1 H8SIM_IOREG(0xffffbd)
+/* スマートカードモードレジスタ */
+#define SCMR1 H8SIM_IOREG(0xffffbe)
+/* チャネル2(3064にはなくて3069にある) */
+/* シリアルモードレジスタ */
+#define SMR2 H8SIM_IOREG(0xffffc0)
+/* ビットレートレジスタ */
+#define BRR2 H8SIM_IOREG(0xffffc1)
+/* シリアルコントロールレジスタ */
+#define SCR2 H8SIM_IOREG(0xffffc2)
+/* トランスミットデータレジスタ */
+#define TDR2 H8SIM_IOREG(0xffffc3)
+/* シリアルステータスレジスタ */
+#define SSR2 H8SIM_IOREG(0xffffc4)
+/* レシーブデータレジスタ */
+#define RDR2 H8SIM_IOREG(0xffffc5)
+/* スマートカードモードレジスタ */
+#define SCMR2 H8SIM_IOREG(0xffffc6)
+
+/* A/D変換器関連 */
+/* A/DデータレジスタAH */
+#define ADDRAH H8SIM_IOREG(0xffffe0)
+/* A/DデータレジスタAL */
+#define ADDRAL H8SIM_IOREG(0xffffe1)
+/* A/DデータレジスタBH */
+#define ADDRBH H8SIM_IOREG(0xffffe2)
+/* A/DデータレジスタBL */
+#define ADDRBL H8SIM_IOREG(0xffffe3)
+/* A/DデータレジスタCH */
+#define ADDRCH H8SIM_IOREG(0xffffe4)
+/* A/DデータレジスタCL */
+#define ADDRCL H8SIM_IOREG(0xffffe5)
+/* A/DデータレジスタDH */
+#define ADDRDH H8SIM_IOREG(0xffffe6)
+/* A/DデータレジスタDL */
+#define ADDRDL H8SIM_IOREG(0xffffe7)
+/* A/Dコントロール/ステータスレジスタ */
+#define ADCSR H8SIM_IOREG(0xffffe8)
+/* A/Dコントロールレジスタ */
+#define ADCR H8SIM_IOREG(0xffffe9)
+
+/* D/A変換器関連 */
+/* D/Aデータレジスタ0 */
+#define DADR0 H8SIM_IOREG(0xffff9c)
+/* D/Aデータレジスタ1 */
+#define DADR1 H8SIM_IOREG(0xffff9d)
+/* D/Aコントロールレジスタ */
+#define DACR H8SIM_IOREG(0xffff9e)
+/* D/Aスタンバイコントロールレジスタ */
+#define DASTCR H8SIM_IOREG(0xfee01A)
@@ -0,0 +1,1784 @@
+/*   H8/300H (アドバンストモード) 命令セットシミュレータ              */
+/*   H8/3069F のうち, ライントレーサが使う部分だけを模擬する          */
+/*     CPU     : H8/300H の全命令 (MOVFPE/MOVTPE を除く)             */
+/*     バス    : ABWCR, ASTCR, WCRH/L によるエリアごとのバス幅と      */
+/*               アクセスステート数, 内蔵ROM/RAM は16ビット2ステート, */
+/*               内蔵I/Oは8ビット3ステート, DRAM リフレッシュの待ち   */
+/*     割り込み: SYSCR の UE, IPRA/IPRB の優先順位, CCR の I/UI       */
+/*     ITU     : ch0-2 のカウンタ, GRA/GRB コンペアマッチ, オーバフロー */
+/*     A/D     : 単一/スキャンモード, 変換時間 134/266 ステート      */
+/*     8ビットタイマ: ch0-3 の PWM 出力(TMO0,TMIO1,TMO2,TMIO3)のデューティ */
+/*     ポート  : ポートB(モータ), ポートA/4(LCD), ポート6(キー)      */
+/*   実行ステート数は「H8/300H シリーズ プログラミングマニュアル」の   */
+/*   命令実行ステート数(I,J,K,L,M,N)に従い, I,J,K,L,M はアクセス先の */
+/*   エリアのステート数で, N は内部動作のステート数で数える           */
+
+#include <stdio.h>
+#include <string.h>
+#include "h8iss.h"
+
+/* CCR のビット */
+#define CCR_I  0x80
+#define CCR_UI 0x40
+#define CCR_H  0x20
+#define CCR_N  0x08
+#define CCR_Z  0x04
+#define CCR_V  0x02
+#define CCR_C  0x01
+
+/* 内蔵I/Oレジスタ(下位16ビットアドレス) */
+#define IO_SYSCR  0xe012
+#define IO_IPRA   0xe018
+#define IO_IPRB   0xe019
+#define IO_ABWCR  0xe020
+#define IO_ASTCR  0xe021
+#define IO_WCRH   0xe022
+#define IO_WCRL   0xe023
+#define IO_BCR    0xe024
+#define IO_DRCRA  0xe026
+#define IO_RTMCSR 0xe028
+#define IO_RTCOR  0xe02a
+#define IO_RAMCR  0xe077
+#define IO_DMA0A  0xff20   /* DMAC ch0A,0B,1A,1B のレジスタは 8 バイトずつ */
+#define IO_TSTR   0xff60
+#define IO_TISRA  0xff64
+#define IO_TISRB  0xff65
+#define IO_TISRC  0xff66
+#define IO_ITU0   0xff68   /* ch n のレジスタは IO_ITU0 + 8*n から */
+#define IO_P4DR   0xffd3
+#define IO_P6DR   0xffd5
+#define IO_PADR   0xffd9
+#define IO_PBDR   0xffda
+#define IO_PBDDR  0xe00a
+#define IO_T8TCR0 0xff80   /* ch0,1 は 0xff80-, ch2,3 は 0xff90- */
+#define IO_T8TCSR0 0xff82
+#define IO_TCORA0 0xff84
+#define IO_T8TCNT0 0xff88
+#define IO_ADDRA  0xffe0
+#define IO_ADCSR  0xffe8
+#define IO_ADCR   0xffe9
+
+/* LCD の制御線(ポートA) */
+#define LCD_RS 0x40
+#define LCD_E  0x10
+
+/* ページテーブル(4kB 単位) */
+#define PAGE_SHIFT 12
+#define PAGE_SIZE  (1 << PAGE_SHIFT)
+#define PAGE_NUM   (0x1000000 >> PAGE_SHIFT)
+
+/* DRAM リフレッシュ1回で CPU が待たされるステート数 */
+#define REFRESH_STATES 3
+
+uint32_t h8_er[8];
+uint32_t h8_pc;
+uint8_t h8_ccr;
+uint64_t h8_states;
+unsigned long h8_insns;
+int h8_error;
+unsigned long h8_dma_count;
+uint64_t h8_dma_states;
+
+int (*h8_adc_input)(int ch);
+void (*h8_output_write)(void);
+
+struct h8_prof h8_vec_prof[H8_VEC_NUM];
+struct h8_prof *(*h8_func_prof)(uint32_t adr);
+
+static uint8_t rom[H8_ROM_SIZE];
+static uint8_t xram[H8_XRAM_SIZE];
+static uint8_t iram[H8_IRAM_SIZE];
+static uint8_t io[0x10000];
+
+static uint8_t *rpage[PAGE_NUM];   /* 直接読めるページ (NULL なら low_read) */
+static uint8_t *wpage[PAGE_NUM];   /* 直接書けるページ (NULL なら low_write) */
+static uint8_t cost8[PAGE_NUM];    /* バイトアクセスのステート数 */
+static uint8_t cost16[PAGE_NUM];   /* ワードアクセスのステート数 */
+static uint8_t page_ext[PAGE_NUM]; /* 外部エリア(リフレッシュの影響を受ける) */
+
+static uint64_t next_refresh;
+static uint64_t refresh_period;
+
+static int sleeping;
+static int irq_inhibit;   /* CCR を書き換えた直後の1命令は割り込みを受け付けない */
+static int irq_vec;       /* 受け付け待ちの最優先の割り込み(なければ -1) */
+static int irq_prio;
+
+/* ITU */
+struct itu {
+  uint64_t last;          /* 最後にカウンタを進めた時刻 */
+  uint64_t event;         /* 次にフラグが立つ時刻 */
+};
+static struct itu itu[3];
+
+/* A/D変換器 */
+static int ad_ch;         /* 変換中のチャネル */
+static uint64_t ad_event; /* 変換が終わる時刻(変換停止中は ~0) */
+
+/* 8ビットタイマ ch0 (コンペアマッチAで A/D変換を起動できる) */
+static uint64_t t8_base;  /* T8TCNT0 の値がその時点の値だった時刻 */
+static uint64_t t8_event; /* 次のコンペアマッチAの時刻(停止中は ~0) */
+
+/* 次に周辺の処理が必要な時刻 */
+static uint64_t next_event;
+
+/* LCD (HD44780) */
+static uint8_t lcd_ddram[0x80];
+static int lcd_addr;
+static int lcd_inc;
+
+/* ISR と関数の集計用スタック */
+#define PROF_DEPTH 64
+struct prof_frame {
+  struct h8_prof *prof;
+  uint64_t start;
+  uint64_t nested_at_entry;
+  int depth;              /* ISR の入れ子の深さ */
+  uint32_t sp;            /* 関数: 戻りアドレスを積んだ後の SP */
+};
+static struct prof_frame isr_stack[PROF_DEPTH];
+static int isr_sp;
+static struct prof_frame func_stack[PROF_DEPTH];
+static int func_sp;
+static uint64_t nested_states[PROF_DEPTH + 1]; /* 深さごとの ISR の総ステート */
+
+static void irq_update(void);
+static void periph_schedule(void);
+
+/*
+ * バス
+ */
+
+static int ext_states(int area, int word)
+     /* 外部エリアのアクセスステート数を返す関数 */
+{
+  int st, wait;
+
+  if (io[IO_ASTCR] & (1 << area)) {
+    if (area >= 4) wait = (io[IO_WCRH] >> ((area - 4) * 2)) & 3;
+    else wait = (io[IO_WCRL] >> (area * 2)) & 3;
+    st = 3 + wait;
+  } else {
+    st = 2;
+  }
+  if (word && (io[IO_ABWCR] & (1 << area))) st *= 2; /* 8ビット幅は2回 */
+  return st;
+}
+
+static void bus_map(void)
+     /* ページテーブルとアクセスステート数を作り直す関数                */
+     /* RAMCR, ABWCR, ASTCR, WCRH/L を書き換えたときに呼ばれる          */
+{
+  uint32_t p, adr;
+  int area;
+
+  for (p = 0; p < PAGE_NUM; p++) {
+    adr = p << PAGE_SHIFT;
+    area = (adr >> 21) & 7;
+    rpage[p] = wpage[p] = NULL;
+    page_ext[p] = 0;
+    if (adr < H8_ROM_START + H8_ROM_SIZE) {
+      rpage[p] = rom + adr;               /* 内蔵ROM (書き込み不可) */
+      cost8[p] = cost16[p] = 2;
+    } else if ((adr >= H8_XRAM_START) && (adr < H8_XRAM_START + H8_XRAM_SIZE)) {
+      rpage[p] = wpage[p] = xram + (adr - H8_XRAM_START);
+      cost8[p] = ext_states(area, 0);
+      cost16[p] = ext_states(area, 1);
+      page_ext[p] = 1;
+    } else if ((adr >= 0xffc000) && (adr < 0xfff000)) {
+      rpage[p] = wpage[p] = iram + (adr - H8_IRAM_START);
+      cost8[p] = cost16[p] = 2;
+    } else {
+      cost8[p] = ext_states(area, 0);     /* 未使用の外部エリアなど */
+      cost16[p] = ext_states(area, 1);
+    }
+  }
+  /* ROMエミュレーション: フラッシュの4kBブロックを内蔵RAMに置き換える */
+  if (io[IO_RAMCR] & 0x08) {
+    p = io[IO_RAMCR] & 0x07;
+    rpage[p] = wpage[p] = iram + (0xffe000 - H8_IRAM_START);
+    cost8[p] = cost16[p] = 2;
+  }
+  /* DRAM リフレッシュの周期 (RTMCSR の CKS, RTCOR) */
+  switch ((io[IO_RTMCSR] >> 3) & 7) {
+  case 1: refresh_period = 2; break;
+  case 2: refresh_period = 8; break;
+  case 3: refresh_period = 32; break;
+  case 4: refresh_period = 128; break;
+  case 5: refresh_period = 512; break;
+  case 6: refresh_period = 2048; break;
+  case 7: refresh_period = 4096; break;
+  default: refresh_period = 0; break;
+  }
+  if ((io[IO_DRCRA] & 0xe0) == 0) refresh_period = 0; /* DRAM 未使用 */
+  refresh_period *= (uint64_t)io[IO_RTCOR] + 1;
+  next_refresh = refresh_period ? h8_states + refresh_period : ~(uint64_t)0;
+}
+
+static void refresh_stall(void)
+     /* 外部アクセスがリフレッシュと重なったときの待ちを加える関数 */
+{
+  h8_states += REFRESH_STATES;
+  next_refresh = (h8_states / refresh_period + 1) * refresh_period;
+}
+
+static int in_iram(uint32_t a)
+{
+  return (a >= H8_IRAM_START) && (a < H8_IRAM_START + H8_IRAM_SIZE);
+}
+
+static int in_io(uint32_t a)
+{
+  return ((a >= 0xfee000) && (a < 0xfee100)) || (a >= 0xffff20);
+}
+
+static uint8_t io_read(uint32_t a);
+static void io_write(uint32_t a, uint8_t v);
+
+static uint8_t low_read8(uint32_t a)
+     /* ページテーブルで直接読めない領域のバイト読み出し */
+{
+  if (in_iram(a)) {
+    h8_states += 2;
+    return iram[a - H8_IRAM_START];
+  }
+  if (in_io(a)) {
+    h8_states += 3;
+    return io_read(a);
+  }
+  h8_states += cost8[a >> PAGE_SHIFT];
+  return 0xff;
+}
+
+static void low_write8(uint32_t a, uint8_t v)
+     /* ページテーブルで直接書けない領域のバイト書き込み */
+{
+  if (in_iram(a)) {
+    h8_states += 2;
+    iram[a - H8_IRAM_START] = v;
+  } else if (in_io(a)) {
+    h8_states += 3;
+    io_write(a, v);
+  } else {
+    h8_states += cost8[a >> PAGE_SHIFT]; /* ROM や未使用領域は無視 */
+  }
+}
+
+static inline uint8_t rd8(uint32_t a)
+{
+  uint32_t p;
+  uint8_t *m;
+
+  a &= 0xffffff;
+  p = a >> PAGE_SHIFT;
+  m = rpage[p];
+  if (m == NULL) return low_read8(a);
+  if (page_ext[p] && (h8_states >= next_refresh)) refresh_stall();
+  h8_states += cost8[p];
+  return m[a & (PAGE_SIZE - 1)];
+}
+
+static inline uint16_t rd16(uint32_t a)
+{
+  uint32_t p;
+  uint8_t *m;
+  uint16_t v;
+  uint64_t st;
+
+  a &= 0xfffffe;
+  p = a >> PAGE_SHIFT;
+  m = rpage[p];
+  if (m == NULL) {
+    if (in_iram(a)) {  /* 内蔵RAMは16ビットバス */
+      h8_states += 2;
+      return (iram[a - H8_IRAM_START] << 8) | iram[a - H8_IRAM_START + 1];
+    }
+    if (((a & 0xffff) >= IO_TSTR) && ((a & 0xffff) < IO_ITU0 + 24)) {
+      /* ITU は16ビットバスで, 16CNT などを一度に読める */
+      h8_states += 3;
+      v = io_read(a) << 8;
+      return v | io[(a + 1) & 0xffff];
+    }
+    st = h8_states;
+    v = low_read8(a) << 8;
+    v |= low_read8(a + 1);
+    if (!in_io(a)) h8_states = st + cost16[p];
+    return v;
+  }
+  if (page_ext[p] && (h8_states >= next_refresh)) refresh_stall();
+  h8_states += cost16[p];
+  m += a & (PAGE_SIZE - 1);
+  return (m[0] << 8) | m[1];
+}
+
+static inline uint32_t rd32(uint32_t a)
+{
+  uint32_t v = (uint32_t)rd16(a) << 16;
+
+  return v | rd16(a + 2);
+}
+
+static inline void wr8(uint32_t a, uint8_t v)
+{
+  uint32_t p;
+  uint8_t *m;
+
+  a &= 0xffffff;
+  p = a >> PAGE_SHIFT;
+  m = wpage[p];
+  if (m == NULL) {
+    low_write8(a, v);
+    return;
+  }
+  if (page_ext[p] && (h8_states >= next_refresh)) refresh_stall();
+  h8_states += cost8[p];
+  m[a & (PAGE_SIZE - 1)] = v;
+}
+
+static inline void wr16(uint32_t a, uint16_t v)
+{
+  uint32_t p;
+  uint8_t *m;
+  uint64_t st;
+
+  a &= 0xfffffe;
+  p = a >> PAGE_SHIFT;
+  m = wpage[p];
+  if (m == NULL) {
+    if (in_iram(a)) {
+      h8_states += 2;
+      iram[a - H8_IRAM_START] = v >> 8;
+      iram[a - H8_IRAM_START + 1] = v;
+      return;
+    }
+    st = h8_states;
+    low_write8(a, v >> 8);
+    low_write8(a + 1, v);
+    if (!in_io(a)) h8_states = st + cost16[p];
+    return;
+  }
+  if (page_ext[p] && (h8_states >= next_refresh)) refresh_stall();
+  h8_states += cost16[p];
+  m += a & (PAGE_SIZE - 1);
+  m[0] = v >> 8;
+  m[1] = v;
+}
+
+static inline void wr32(uint32_t a, uint32_t v)
+{
+  wr16(a, v >> 16);
+  wr16(a + 2, v);
+}
+
+static inline uint16_t fetch(void)
+     /* 命令を1ワード読んで PC を進める */
+{
+  uint16_t v = rd16(h8_pc);
+
+  h8_pc = (h8_pc + 2) & 0xffffff;
+  return v;
+}
+
+static inline void prefetch(void)
+     /* 分岐などで次の命令を先読みする分のステートを加える */
+{
+  uint32_t p = (h8_pc >> PAGE_SHIFT) & (PAGE_NUM - 1);
+
+  if (rpage[p] == NULL) h8_states += in_iram(h8_pc) ? 2 : cost16[p];
+  else h8_states += cost16[p];
+}
+
+uint8_t h8_peek8(uint32_t a)
+{
+  uint32_t p;
+
+  a &= 0xffffff;
+  p = a >> PAGE_SHIFT;
+  if (rpage[p] != NULL) return rpage[p][a & (PAGE_SIZE - 1)];
+  if (in_iram(a)) return iram[a - H8_IRAM_START];
+  if (in_io(a)) return io[a & 0xffff];
+  return 0xff;
+}
+
+void h8_poke8(uint32_t a, uint8_t v)
+{
+  uint32_t p;
+
+  a &= 0xffffff;
+  p = a >> PAGE_SHIFT;
+  if (wpage[p] != NULL) wpage[p][a & (PAGE_SIZE - 1)] = v;
+  else if (in_iram(a)) iram[a - H8_IRAM_START] = v;
+  else if (a < H8_ROM_START + H8_ROM_SIZE) rom[a] = v;
+}
+
+int h8_load(uint32_t adr, const uint8_t *data, uint32_t len)
+{
+  uint32_t i, a;
+
+  for (i = 0; i < len; i++) {
+    a = (adr + i) & 0xffffff;
+    if (a < H8_ROM_START + H8_ROM_SIZE) rom[a] = data[i];
+    else if ((a >= H8_XRAM_START) && (a < H8_XRAM_START + H8_XRAM_SIZE))
+      xram[a - H8_XRAM_START] = data[i];
+    else if (in_iram(a)) iram[a - H8_IRAM_START] = data[i];
+    else return -1;
+  }
+  return 0;
+}
+
+/*
+ * ITU (16ビットタイマ ch0-2)
+ */
+
+static int itu_div(int ch)
+     /* TPSC によるカウントの分周比 (外部クロックは未対応で φ/8 扱い) */
+{
+  int tpsc = io[IO_ITU0 + 8 * ch] & 7;
+
+  return 1 << (tpsc > 3 ? 3 : tpsc);
+}
+
+static uint16_t itu_reg16(int ch, int ofs)
+{
+  int a = IO_ITU0 + 8 * ch + ofs;
+
+  return (io[a] << 8) | io[a + 1];
+}
+
+static void itu_sync(int ch)
+     /* ch のカウンタを現在時刻まで進め, コンペアマッチのフラグを立てる */
+{
+  struct itu *t = &itu[ch];
+  uint64_t n;
+  uint32_t tcnt, gra, grb, d, dA, dB, dO;
+  int div, cclr;
+
+  if ((io[IO_TSTR] & (1 << ch)) == 0) {
+    t->last = h8_states;
+    return;
+  }
+  div = itu_div(ch);
+  n = h8_states / div - t->last / div;
+  t->last = h8_states;
+  if (n == 0) return;
+  tcnt = itu_reg16(ch, 2);
+  gra = itu_reg16(ch, 4);
+  grb = itu_reg16(ch, 6);
+  cclr = (io[IO_ITU0 + 8 * ch] >> 5) & 3;
+  while (n > 0) {
+    /* クリア条件の GR に一致している次のカウントで 0 に戻る */
+    if (((cclr == 1) && (tcnt == gra)) || ((cclr == 2) && (tcnt == grb))) {
+      tcnt = 0;
+      n--;
+      if ((tcnt == gra) && (cclr != 1)) io[IO_TISRA] |= 1 << ch;
+      continue;
+    }
+    dA = (gra - tcnt) & 0xffff; if (dA == 0) dA = 0x10000;
+    dB = (grb - tcnt) & 0xffff; if (dB == 0) dB = 0x10000;
+    dO = 0x10000 - tcnt;
+    d = dA < dB ? dA : dB;
+    if (dO < d) d = dO;
+    if (n < d) {
+      tcnt = (tcnt + n) & 0xffff;
+      break;
+    }
+    n -= d;
+    tcnt = (tcnt + d) & 0xffff;
+    if (d == dO) io[IO_TISRC] |= 1 << ch;     /* オーバフロー */
+    if (tcnt == gra) io[IO_TISRA] |= 1 << ch; /* IMFA */
+    if (tcnt == grb) io[IO_TISRB] |= 1 << ch; /* IMFB */
+  }
+  io[IO_ITU0 + 8 * ch + 2] = tcnt >> 8;
+  io[IO_ITU0 + 8 * ch + 3] = tcnt;
+}
+
+static void itu_schedule(int ch)
+     /* ch の次にフラグが立つ時刻を求める */
+{
+  struct itu *t = &itu[ch];
+  uint32_t tcnt, gra, grb, dA, dB, dO, d;
+  int div, cclr;
+
+  if ((io[IO_TSTR] & (1 << ch)) == 0) {
+    t->event = ~(uint64_t)0;
+    return;
+  }
+  div = itu_div(ch);
+  tcnt = itu_reg16(ch, 2);
+  gra = itu_reg16(ch, 4);
+  grb = itu_reg16(ch, 6);
+  cclr = (io[IO_ITU0 + 8 * ch] >> 5) & 3;
+  dA = (gra - tcnt) & 0xffff; if (dA == 0) dA = 0x10000;
+  dB = (grb - tcnt) & 0xffff; if (dB == 0) dB = 0x10000;
+  dO = 0x10000 - tcnt;
+  if (((cclr == 1) && (tcnt == gra)) || ((cclr == 2) && (tcnt == grb))) {
+    dA = gra + 1; dB = grb + 1; dO = 0x10000;
+  }
+  d = dA < dB ? dA : dB;
+  if (dO < d) d = dO;
+  t->event = (h8_states / div + d) * div;
+}
+
+static void itu_sync_all(void)
+{
+  int ch;
+
+  for (ch = 0; ch < 3; ch++) itu_sync(ch);
+}
+
+/*
+ * A/D変換器
+ */
+
+static int ad_conv_states(void)
+     /* 最初のチャネルの変換時間 */
+{
+  return (io[IO_ADCSR] & 0x08) ? 134 : 266;
+}
+
+static int ad_next_states(void)
+     /* スキャンモードの2回目以降の変換時間(固定) */
+{
+  return (io[IO_ADCSR] & 0x08) ? 128 : 256;
+}
+
+static void ad_start(void)
+     /* ADST がセットされたときに変換を開始する */
+{
+  uint8_t csr = io[IO_ADCSR];
+
+  ad_ch = (csr & 0x10) ? (csr & 0x04) : (csr & 0x07);
+  ad_event = h8_states + ad_conv_states();
+}
+
+static int dma_adi(void)
+     /* A/D変換終了(ADI)で起動される DMAC のショートアドレスモードの転送 */
+     /* I/O(IOAR) -> メモリ(MAR)の方向に, 0A,0B,1A,1B の順に1回ずつ転送する */
+     /* 転送のバスサイクルの分だけ CPU を止める(サイクルスチール)          */
+     /* 起動したチャネルがあれば 1 を返す(ADF は DMAC がクリアする)         */
+{
+  uint8_t *d;
+  uint32_t mar, src;
+  uint64_t start = h8_states;
+  int n, step, count, act = 0;
+
+  for (n = 0; n < 4; n++) {
+    d = &io[IO_DMA0A + 8 * n];
+    if ((d[7] & 0x87) != 0x83) continue;     /* DTE=1, DTS=ADI */
+    mar = ((uint32_t)d[1] << 16) | (d[2] << 8) | d[3];
+    src = 0xffff00 | d[6];
+    if (d[7] & 0x40) {                       /* ワード転送 */
+      wr16(mar & ~1, rd16(src & ~1));
+      step = 2;
+    } else {
+      wr8(mar, rd8(src));
+      step = 1;
+    }
+    if (d[7] & 0x20) step = -step;           /* DTID: MAR を減少 */
+    mar += step;
+    if (--d[4] == 0) {                       /* ETCRH */
+      if (d[7] & 0x10) {                     /* リピートモード: 元に戻す */
+        count = d[5] ? d[5] : 256;
+        d[4] = d[5];
+        mar -= step * count;
+      } else {
+        d[7] &= ~0x80;                       /* 転送終了 */
+      }
+    }
+    d[1] = (mar >> 16) & 0xff;
+    d[2] = (mar >> 8) & 0xff;
+    d[3] = mar & 0xff;
+    h8_dma_count++;
+    act = 1;
+  }
+  h8_dma_states += h8_states - start;
+  return act;
+}
+
+static void ad_done(void)
+     /* 1チャネル分の変換が終わったときの処理 */
+{
+  uint8_t csr = io[IO_ADCSR];
+  int v, last;
+
+  v = h8_adc_input ? h8_adc_input(ad_ch) : 0;
+  io[IO_ADDRA + 2 * (ad_ch & 3)] = (v >> 2) & 0xff;
+  io[IO_ADDRA + 2 * (ad_ch & 3) + 1] = (v << 6) & 0xc0;
+  if (csr & 0x10) {                       /* スキャンモード */
+    last = csr & 0x07;
+    if (ad_ch < last) {
+      ad_ch++;
+      ad_event += ad_next_states();
+      return;
+    }
+    io[IO_ADCSR] |= 0x80;                 /* ADF, 変換は最初から続ける */
+    ad_ch = csr & 0x04;
+    ad_event += ad_next_states();
+  } else {                                /* 単一モード */
+    io[IO_ADCSR] = (csr | 0x80) & ~0x20;  /* ADF をセットして停止 */
+    ad_event = ~(uint64_t)0;
+  }
+  if ((csr & 0x40) && dma_adi()) io[IO_ADCSR] &= ~0x80;
+}
+
+/*
+ * 周辺のイベント処理
+ */
+
+/*
+ * 8ビットタイマ ch0 のカウンタ (A/D変換の起動だけを模擬する)
+ */
+
+static int t8_div(void)
+     /* カウンタの分周比 (停止中と外部クロックは 0) */
+{
+  switch (io[IO_T8TCR0] & 7) {
+  case 1: return 8;
+  case 2: return 64;
+  case 3: return 8192;
+  default: return 0;
+  }
+}
+
+static int t8_period(void)
+     /* カウンタが一周するカウント数 */
+{
+  return ((io[IO_T8TCR0] & 0x18) == 0x08) ? io[IO_TCORA0] + 1 : 256;
+}
+
+static void t8_sync(void)
+     /* T8TCNT0 を現在の時刻まで進める */
+{
+  int div = t8_div();
+  uint64_t n;
+
+  if (div) {
+    n = (h8_states - t8_base) / div;
+    io[IO_T8TCNT0] = (io[IO_T8TCNT0] + n) % t8_period();
+    t8_base += n * div;
+  } else {
+    t8_base = h8_states;
+  }
+}
+
+static void t8_schedule(void)
+     /* 次のコンペアマッチAの時刻を求める */
+{
+  int div = t8_div();
+  int d;
+
+  if (div == 0) {
+    t8_event = ~(uint64_t)0;
+    return;
+  }
+  d = (io[IO_TCORA0] - io[IO_T8TCNT0]) & 0xff;
+  t8_event = t8_base + (uint64_t)(d + 1) * div;
+}
+
+static void t8_match(void)
+     /* コンペアマッチA: ADTE と ADCR の TRGE が 1 なら A/D変換を開始する */
+{
+  t8_base = t8_event;
+  io[IO_T8TCNT0] = ((io[IO_T8TCR0] & 0x18) == 0x08) ? 0 : (io[IO_TCORA0] + 1) & 0xff;
+  io[IO_T8TCSR0] |= 0x40;                 /* CMFA */
+  if ((io[IO_ADCR] & 0x80) && (io[IO_T8TCSR0] & 0x10) && !(io[IO_ADCSR] & 0x20)) {
+    io[IO_ADCSR] |= 0x20;                 /* ADST */
+    ad_start();
+  }
+  t8_schedule();
+}
+
+static void periph_schedule(void)
+{
+  int ch;
+
+  next_event = ad_event;
+  if (t8_event < next_event) next_event = t8_event;
+  for (ch = 0; ch < 3; ch++)
+    if (itu[ch].event < next_event) next_event = itu[ch].event;
+}
+
+static void periph_events(void)
+     /* 時刻が next_event に達したときの周辺の処理 */
+{
+  int ch;
+
+  for (ch = 0; ch < 3; ch++) {
+    if (itu[ch].event <= h8_states) {
+      itu_sync(ch);
+      itu_schedule(ch);
+    }
+  }
+  while (t8_event <= h8_states) t8_match();
+  while (ad_event <= h8_states) ad_done();
+  periph_schedule();
+  irq_update();
+}
+
+/*
+ * 内蔵I/Oレジスタ
+ */
+
+static void lcd_write(uint8_t v, int rs)
+     /* HD44780 にコマンドまたはデータを書く */
+{
+  if (rs) {
+    lcd_ddram[lcd_addr & 0x7f] = v;
+    lcd_addr = (lcd_addr + lcd_inc) & 0x7f;
+  } else if (v & 0x80) {                  /* DDRAM アドレスセット */
+    lcd_addr = v & 0x7f;
+  } else if (v & 0x40) {                  /* CGRAM は扱わない */
+  } else if (v & 0x04) {
+    if ((v & 0xfc) == 0x04) lcd_inc = (v & 0x02) ? 1 : -1; /* エントリーモード */
+  } else if (v & 0x02) {                  /* カーソルホーム */
+    lcd_addr = 0;
+  } else if (v & 0x01) {                  /* 表示クリア */
+    memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+    lcd_addr = 0;
+    lcd_inc = 1;
+  }
+}
+
+void h8_lcd_line(int row, char *buf)
+{
+  int i;
+  uint8_t c;
+
+  for (i = 0; i < 16; i++) {
+    c = lcd_ddram[(row ? 0x40 : 0x00) + i];
+    buf[i] = ((c >= 0x20) && (c < 0x7f)) ? c : ' ';
+  }
+  buf[16] = '\0';
+}
+
+double h8_portb_duty(int bit)
+     /* PB0-3 で8ビットタイマの出力が選ばれていれば(TCSR の OS が 0 でない) */
+     /* TCORA のコンペアマッチ(クリア)で 1, TCORB で 0 にする PWM とみなす   */
+{
+  int base = IO_T8TCR0 + ((bit & 2) ? 0x10 : 0) + (bit & 1);
+  uint8_t os, tcora, tcorb;
+
+  if ((bit < 4) && ((os = io[base + 2] & 0x0f) != 0)) {
+    if ((io[base] & 0x07) == 0) return 0.0;       /* カウント停止中 */
+    tcora = io[base + 4];
+    tcorb = io[base + 6];
+    switch (os) {
+    case 0x0a: return 1.0;                        /* 常に 1 */
+    case 0x06:                                    /* PWM */
+      if (tcorb >= tcora) return 1.0;
+      return (tcorb + 1.0) / (tcora + 1.0);
+    default:   return 0.0;
+    }
+  }
+  return ((io[IO_PBDDR] & io[IO_PBDR]) >> bit) & 1;
+}
+
+static uint8_t io_read(uint32_t a)
+{
+  int r = a & 0xffff;
+
+  if ((r >= IO_TSTR) && (r < IO_ITU0 + 24)) itu_sync_all();
+  if (r == IO_P6DR) return io[r] | 0x03;  /* キーは押されていない */
+  return io[r];
+}
+
+static void io_write(uint32_t a, uint8_t v)
+{
+  int r = a & 0xffff;
+  uint8_t old = io[r];
+
+  switch (r) {
+  case IO_RAMCR: case IO_ABWCR: case IO_ASTCR: case IO_WCRH: case IO_WCRL:
+  case IO_RTMCSR: case IO_RTCOR: case IO_DRCRA:
+    io[r] = v;
+    bus_map();
+    return;
+  case IO_SYSCR: case IO_IPRA: case IO_IPRB:
+    io[r] = v;
+    irq_update();
+    return;
+  case IO_TISRA: case IO_TISRB: case IO_TISRC:
+    itu_sync_all();
+    io[r] = 0x88 | (v & 0x70) | (old & v & 0x07); /* フラグは 0 書き込みでクリア */
+    irq_update();
+    return;
+  case IO_ADCSR:
+    io[r] = (old & v & 0x80) | (v & 0x7f);
+    if ((v & 0x20) == 0) ad_event = ~(uint64_t)0;
+    else if (((old & 0x20) == 0) || ((old ^ v) & 0x17)) ad_start();
+    periph_schedule();
+    irq_update();
+    return;
+  case IO_PADR:
+    io[r] = v;
+    if ((old & LCD_E) && !(v & LCD_E)) lcd_write(io[IO_P4DR], v & LCD_RS);
+    return;
+  case IO_PBDR: case IO_PBDDR:
+    io[r] = v;
+    if ((v != old) && h8_output_write) h8_output_write();
+    return;
+  default:
+    break;
+  }
+  if ((r == IO_T8TCR0) || (r == IO_TCORA0) || (r == IO_T8TCNT0)) {
+    /* 8ビットタイマ ch0 のコンペアマッチAの周期が変わる */
+    t8_sync();
+    io[r] = v;
+    t8_schedule();
+    periph_schedule();
+  }
+  if ((r & 0xffe8) == IO_T8TCR0) {
+    /* 8ビットタイマ ch0-3 の TCR, TCSR, TCORA, TCORB */
+    io[r] = v;
+    if ((v != old) && h8_output_write) h8_output_write();
+    return;
+  }
+  if ((r >= IO_TSTR) && (r < IO_ITU0 + 24)) {
+    itu_sync_all();
+    io[r] = v;
+    itu[0].last = itu[1].last = itu[2].last = h8_states;
+    itu_schedule(0); itu_schedule(1); itu_schedule(2);
+    periph_schedule();
+    irq_update();
+    return;
+  }
+  io[r] = v;
+}
+
+/*
+ * 割り込み
+ */
+
+static void irq_request(int vec, int prio)
+{
+  if ((irq_vec < 0) || (prio > irq_prio) || ((prio == irq_prio) && (vec < irq_vec))) {
+    irq_vec = vec;
+    irq_prio = prio;
+  }
+}
+
+static void irq_update(void)
+     /* 要求されている割り込みのうち最優先のものを求める */
+{
+  int ch;
+  uint8_t ipra = io[IO_IPRA], ipr;
+
+  irq_vec = -1;
+  irq_prio = 0;
+  for (ch = 0; ch < 3; ch++) {
+    ipr = (ipra >> (2 - ch)) & 1;   /* IPRA2-0 : ITU ch0-2 */
+    if ((io[IO_TISRA] & (0x11 << ch)) == (0x11 << ch))
+      irq_request(H8_VEC_IMIA0 + 4 * ch, ipr);
+    if ((io[IO_TISRB] & (0x11 << ch)) == (0x11 << ch))
+      irq_request(H8_VEC_IMIB0 + 4 * ch, ipr);
+    if ((io[IO_TISRC] & (0x11 << ch)) == (0x11 << ch))
+      irq_request(H8_VEC_OVI0 + 4 * ch, ipr);
+  }
+  if ((io[IO_ADCSR] & 0xc0) == 0xc0)
+    irq_request(H8_VEC_ADI, (io[IO_IPRB] >> 1) & 1);  /* IPRB1 : A/D */
+}
+
+static int irq_acceptable(void)
+     /* CCR と SYSCR の UE ビットで割り込みを受け付けられるか調べる */
+{
+  if (irq_vec < 0) return 0;
+  if (io[IO_SYSCR] & 0x08) return (h8_ccr & CCR_I) == 0;
+  if ((h8_ccr & CCR_I) == 0) return 1;
+  return irq_prio && ((h8_ccr & CCR_UI) == 0);
+}
+
+static void prof_enter_isr(int vec)
+{
+  struct prof_frame *f;
+
+  if (isr_sp >= PROF_DEPTH) return;
+  f = &isr_stack[isr_sp];
+  f->prof = &h8_vec_prof[vec];
+  if (f->prof->first == 0) f->prof->first = h8_states;
+  f->start = h8_states;
+  f->depth = isr_sp;
+  f->nested_at_entry = nested_states[isr_sp + 1];
+  isr_sp++;
+}
+
+static void prof_account(struct prof_frame *f, uint64_t nested)
+{
+  uint64_t total = h8_states - f->start;
+  uint64_t self = total - nested;
+  struct h8_prof *p = f->prof;
+
+  p->calls++;
+  p->total += total;
+  p->self += self;
+  if ((p->calls == 1) || (self < p->min)) p->min = self;
+  if (self > p->max) p->max = self;
+}
+
+static void prof_leave_isr(void)
+{
+  struct prof_frame *f;
+
+  if (isr_sp <= 0) return;
+  isr_sp--;
+  f = &isr_stack[isr_sp];
+  prof_account(f, nested_states[isr_sp + 1] - f->nested_at_entry);
+  nested_states[isr_sp] += h8_states - f->start;
+}
+
+static void exception(int vec)
+     /* 例外処理 (割り込み, TRAPA)                       */
+     /* CCR と PC を積んでベクタから分岐する (I=2,J=2,K=2,N=4) */
+     /* UE=0 のときは優先順位によらず I と UI の両方が 1 になる */
+{
+  uint32_t sp;
+
+  sleeping = 0;
+  prof_enter_isr(vec);
+  sp = (h8_er[7] - 4) & 0xffffff;
+  h8_er[7] = sp;
+  wr32(sp, ((uint32_t)h8_ccr << 24) | h8_pc);
+  h8_ccr |= CCR_I;
+  if ((io[IO_SYSCR] & 0x08) == 0) h8_ccr |= CCR_UI;
+  h8_pc = rd32(vec * 4) & 0xffffff;
+  h8_states += 4;
+  prefetch();
+  prefetch();
+}
+
+/*
+ * 関数の集計
+ */
+
+static void prof_call(uint32_t target)
+{
+  struct h8_prof *p;
+  struct prof_frame *f;
+
+  if ((h8_func_prof == NULL) || (func_sp >= PROF_DEPTH)) return;
+  p = h8_func_prof(target);
+  if (p == NULL) return;
+  if (p->first == 0) p->first = h8_states;
+  f = &func_stack[func_sp++];
+  f->prof = p;
+  f->start = h8_states;
+  f->sp = h8_er[7];
+  f->depth = isr_sp;
+  f->nested_at_entry = nested_states[isr_sp];
+}
+
+static void prof_return(void)
+     /* RTS の直前(SP が戻りアドレスを指している)に呼ぶ */
+{
+  struct prof_frame *f;
+
+  while (func_sp > 0) {
+    f = &func_stack[func_sp - 1];
+    if (f->sp > h8_er[7]) return;         /* 内側の関数の RTS */
+    func_sp--;
+    if (f->sp == h8_er[7]) {
+      prof_account(f, nested_states[f->depth] - f->nested_at_entry);
+      return;
+    }
+  }
+}
+
+/*
+ * レジスタとフラグ
+ */
+
+static inline uint8_t r8(int n)
+{
+  return (n & 8) ? h8_er[n & 7] & 0xff : (h8_er[n & 7] >> 8) & 0xff;
+}
+
+static inline void w8(int n, uint8_t v)
+{
+  if (n & 8) h8_er[n & 7] = (h8_er[n & 7] & 0xffffff00) | v;
+  else h8_er[n & 7] = (h8_er[n & 7] & 0xffff00ff) | ((uint32_t)v << 8);
+}
+
+static inline uint16_t r16(int n)
+{
+  return (n & 8) ? h8_er[n & 7] >> 16 : h8_er[n & 7] & 0xffff;
+}
+
+static inline void w16(int n, uint16_t v)
+{
+  if (n & 8) h8_er[n & 7] = (h8_er[n & 7] & 0x0000ffff) | ((uint32_t)v << 16);
+  else h8_er[n & 7] = (h8_er[n & 7] & 0xffff0000) | v;
+}
+
+/* オペランドサイズ: 0=バイト, 1=ワード, 2=ロングワード */
+static const uint32_t sz_mask[3] = { 0xff, 0xffff, 0xffffffff };
+static const uint32_t sz_msb[3] = { 0x80, 0x8000, 0x80000000 };
+static const uint32_t sz_hmask[3] = { 0x0f, 0x0fff, 0x0fffffff };
+
+static inline void set_nz(uint32_t v, int sz)
+     /* N, Z を結果から決め, V をクリアする (MOV, 論理演算など) */
+{
+  v &= sz_mask[sz];
+  h8_ccr &= ~(CCR_N | CCR_Z | CCR_V);
+  if (v & sz_msb[sz]) h8_ccr |= CCR_N;
+  if (v == 0) h8_ccr |= CCR_Z;
+}
+
+static uint32_t op_add(uint32_t a, uint32_t b, int c, int sz, int keepz)
+     /* 加算 (ADD, ADDX) : H, N, Z, V, C を設定 */
+{
+  uint32_t m = sz_mask[sz], msb = sz_msb[sz], hm = sz_hmask[sz];
+  uint64_t r;
+  uint32_t res;
+  uint8_t ccr = h8_ccr & (CCR_I | CCR_UI | 0x10);
+
+  a &= m; b &= m;
+  r = (uint64_t)a + b + c;
+  res = (uint32_t)r & m;
+  if (((a & hm) + (b & hm) + c) > hm) ccr |= CCR_H;
+  if (res & msb) ccr |= CCR_N;
+  if (res == 0) { if (!keepz || (h8_ccr & CCR_Z)) ccr |= CCR_Z; }
+  if (~(a ^ b) & (a ^ res) & msb) ccr |= CCR_V;
+  if (r > m) ccr |= CCR_C;
+  h8_ccr = ccr;
+  return res;
+}
+
+static uint32_t op_sub(uint32_t a, uint32_t b, int c, int sz, int keepz)
+     /* 減算 (SUB, SUBX, CMP, NEG) : H, N, Z, V, C を設定 */
+{
+  uint32_t m = sz_mask[sz], msb = sz_msb[sz], hm = sz_hmask[sz];
+  uint32_t res;
+  uint8_t ccr = h8_ccr & (CCR_I | CCR_UI | 0x10);
+
+  a &= m; b &= m;
+  res = (a - b - c) & m;
+  if ((a & hm) < (b & hm) + c) ccr |= CCR_H;
+  if (res & msb) ccr |= CCR_N;
+  if (res == 0) { if (!keepz || (h8_ccr & CCR_Z)) ccr |= CCR_Z; }
+  if ((a ^ b) & (a ^ res) & msb) ccr |= CCR_V;
+  if ((uint64_t)a < (uint64_t)b + c) ccr |= CCR_C;
+  h8_ccr = ccr;
+  return res;
+}
+
+static uint32_t op_incdec(uint32_t a, int d, int sz)
+     /* INC, DEC : N, Z, V を設定 (C, H は変化しない) */
+{
+  uint32_t m = sz_mask[sz], msb = sz_msb[sz];
+  uint32_t res = (a + d) & m;
+
+  h8_ccr &= ~(CCR_N | CCR_Z | CCR_V);
+  if (res & msb) h8_ccr |= CCR_N;
+  if (res == 0) h8_ccr |= CCR_Z;
+  if ((d > 0) && ((a & m) < msb) && (res >= msb)) h8_ccr |= CCR_V;
+  if ((d < 0) && ((a & m) >= msb) && (res < msb)) h8_ccr |= CCR_V;
+  return res;
+}
+
+static uint32_t op_shift(int kind, uint32_t a, int sz)
+     /* シフト, ローテート                                     */
+     /* kind: 0x10 SHLL 0x18 SHAL 0x11 SHLR 0x19 SHAR           */
+     /*       0x12 ROTXL 0x1a ROTL 0x13 ROTXR 0x1b ROTR         */
+{
+  uint32_t m = sz_mask[sz], msb = sz_msb[sz];
+  uint32_t res;
+  int c, oldc = h8_ccr & CCR_C;
+
+  a &= m;
+  switch (kind) {
+  case 0x10: case 0x18: c = (a & msb) != 0; res = a << 1; break;
+  case 0x11: c = a & 1; res = a >> 1; break;
+  case 0x19: c = a & 1; res = (a >> 1) | (a & msb); break;
+  case 0x12: c = (a & msb) != 0; res = (a << 1) | oldc; break;
+  case 0x1a: c = (a & msb) != 0; res = (a << 1) | c; break;
+  case 0x13: c = a & 1; res = (a >> 1) | (oldc ? msb : 0); break;
+  default:   c = a & 1; res = (a >> 1) | (c ? msb : 0); break;
+  }
+  res &= m;
+  set_nz(res, sz);
+  h8_ccr = (h8_ccr & ~CCR_C) | (c ? CCR_C : 0);
+  if ((kind == 0x18) && ((a ^ res) & msb)) h8_ccr |= CCR_V;
+  return res;
+}
+
+static int cond(int cc)
+     /* Bcc の分岐条件 */
+{
+  int c = h8_ccr & CCR_C, z = (h8_ccr & CCR_Z) != 0;
+  int n = (h8_ccr & CCR_N) != 0, v = (h8_ccr & CCR_V) != 0;
+
+  switch (cc) {
+  case 0x0: return 1;                     /* BRA */
+  case 0x1: return 0;                     /* BRN */
+  case 0x2: return !(c || z);             /* BHI */
+  case 0x3: return c || z;                /* BLS */
+  case 0x4: return !c;                    /* BCC */
+  case 0x5: return c != 0;                /* BCS */
+  case 0x6: return !z;                    /* BNE */
+  case 0x7: return z;                     /* BEQ */
+  case 0x8: return !v;                    /* BVC */
+  case 0x9: return v;                     /* BVS */
+  case 0xa: return !n;                    /* BPL */
+  case 0xb: return n;                     /* BMI */
+  case 0xc: return n == v;                /* BGE */
+  case 0xd: return n != v;                /* BLT */
+  case 0xe: return !z && (n == v);        /* BGT */
+  default:  return z || (n != v);         /* BLE */
+  }
+}
+
+static uint8_t bitop(int op, int inv, int bit, uint8_t v, int *write)
+     /* ビット操作命令 (op は命令コードの上位バイト 0x60-0x77) */
+{
+  uint8_t mask = 1 << (bit & 7);
+  int b = (v & mask) != 0;
+  int c = h8_ccr & CCR_C;
+
+  *write = 0;
+  if (inv) b = !b;
+  switch (op) {
+  case 0x60: case 0x70: *write = 1; return v | mask;   /* BSET */
+  case 0x61: case 0x71: *write = 1; return v ^ mask;   /* BNOT */
+  case 0x62: case 0x72: *write = 1; return v & ~mask;  /* BCLR */
+  case 0x63: case 0x73:                                /* BTST */
+    if (b) h8_ccr &= ~CCR_Z; else h8_ccr |= CCR_Z;
+    return v;
+  case 0x67:                                           /* BST, BIST */
+    *write = 1;
+    return (c ^ inv) ? (v | mask) : (v & ~mask);
+  case 0x74: c = c | b; break;                         /* BOR, BIOR */
+  case 0x75: c = c ^ b; break;                         /* BXOR, BIXOR */
+  case 0x76: c = c & b; break;                         /* BAND, BIAND */
+  default:   c = b; break;                             /* BLD, BILD */
+  }
+  h8_ccr = (h8_ccr & ~CCR_C) | (c ? CCR_C : 0);
+  return v;
+}
+
+static void bitop_mem(uint32_t adr, uint16_t op2)
+     /* @ERd, @aa:8 に対するビット操作 */
+{
+  int op = op2 >> 8, write, bit;
+  uint8_t v, r;
+
+  v = rd8(adr);
+  if ((op == 0x60) || (op == 0x61) || (op == 0x62) || (op == 0x63))
+    bit = r8((op2 >> 4) & 0xf);           /* ビット番号はレジスタで指定 */
+  else
+    bit = (op2 >> 4) & 7;
+  r = bitop(op, (op2 & 0x80) && (op >= 0x67), bit, v, &write);
+  if (write) wr8(adr, r);
+}
+
+static void undefined(uint16_t op)
+{
+  fprintf(stderr, "h8iss: undefined instruction %04x at %06x\n",
+          op, (h8_pc - 2) & 0xffffff);
+  h8_error = 1;
+}
+
+static void call(uint32_t target)
+     /* サブルーチン呼び出し: 戻りアドレス(32ビット)を積む */
+{
+  h8_er[7] = (h8_er[7] - 4) & 0xffffff;
+  wr32(h8_er[7], h8_pc);
+  h8_pc = target & 0xffffff;
+  prof_call(h8_pc);
+}
+
+static uint32_t disp24(void)
+     /* @(d:24,ERn) と @aa:24 の 32ビットフィールドを読む */
+{
+  uint32_t v = (uint32_t)fetch() << 16;
+
+  v |= fetch();
+  return v;
+}
+
+static void mov_l(void)
+     /* 01 00 で始まる MOV.L のメモリ形式 */
+{
+  uint16_t op2 = fetch();
+  int hi = op2 >> 8, b = op2 & 0xff;
+  int rs = (b >> 4) & 7, rd = b & 7;
+  uint32_t adr, v;
+
+  switch (hi) {
+  case 0x69:                              /* @ERs */
+    if (b & 0x80) { v = h8_er[rd]; wr32(h8_er[rs], v); }
+    else { v = rd32(h8_er[rs]); h8_er[rd] = v; }
+    break;
+  case 0x6b:                              /* @aa:16, @aa:24 */
+    adr = ((b & 0x20) ? disp24() : (uint32_t)(int16_t)fetch()) & 0xffffff;
+    if (b & 0x80) { v = h8_er[rd]; wr32(adr, v); }
+    else { v = rd32(adr); h8_er[rd] = v; }
+    break;
+  case 0x6d:                              /* @ERs+, @-ERd */
+    h8_states += 2;
+    if (b & 0x80) {
+      v = h8_er[rd];
+      h8_er[rs] = (h8_er[rs] - 4) & 0xffffffff;
+      wr32(h8_er[rs], v);
+    } else {
+      v = rd32(h8_er[rs]);
+      h8_er[rs] += 4;
+      h8_er[rd] = v;
+    }
+    break;
+  case 0x6f:                              /* @(d:16,ERs) */
+    adr = h8_er[rs] + (int16_t)fetch();
+    if (b & 0x80) { v = h8_er[rd]; wr32(adr, v); }
+    else { v = rd32(adr); h8_er[rd] = v; }
+    break;
+  case 0x78:                              /* @(d:24,ERs) */
+    op2 = fetch();
+    adr = h8_er[rs] + disp24();
+    rd = op2 & 7;
+    if (op2 & 0x80) { v = h8_er[rd]; wr32(adr, v); }
+    else { v = rd32(adr); h8_er[rd] = v; }
+    break;
+  default:
+    undefined(op2);
+    return;
+  }
+  set_nz(v, 2);
+}
+
+static void ldc_stc(void)
+     /* 01 40 で始まる LDC/STC のメモリ形式 (CCR はワードの上位バイト) */
+{
+  uint16_t op2 = fetch();
+  int hi = op2 >> 8, b = op2 & 0xff;
+  int rn = (b >> 4) & 7, store = b & 0x80;
+  uint32_t adr;
+
+  switch (hi) {
+  case 0x69: adr = h8_er[rn]; break;
+  case 0x6b: adr = (b & 0x20) ? disp24() : (uint32_t)(int16_t)fetch(); break;
+  case 0x6d:
+    h8_states += 2;
+    if (store) { h8_er[rn] -= 2; adr = h8_er[rn]; }
+    else { adr = h8_er[rn]; h8_er[rn] += 2; }
+    break;
+  case 0x6f: adr = h8_er[rn] + (int16_t)fetch(); break;
+  case 0x78: op2 = fetch(); store = op2 & 0x80; adr = h8_er[rn] + disp24(); break;
+  default: undefined(op2); return;
+  }
+  if (store) wr16(adr, (uint16_t)h8_ccr << 8);
+  else { h8_ccr = rd16(adr) >> 8; irq_inhibit = 1; }
+}
+
+static void mov_mem(int hi, int b)
+     /* MOV.B / MOV.W のメモリ形式 (0x68-0x6f) */
+{
+  int sz = hi & 1, store = b & 0x80;
+  int rn = (b >> 4) & 7, r = b & 0xf;
+  uint32_t adr, v = 0;
+
+  switch (hi) {
+  case 0x68: case 0x69: adr = h8_er[rn]; break;
+  case 0x6c: case 0x6d:
+    h8_states += 2;
+    if (store) {
+      v = sz ? r16(r) : r8(r);
+      h8_er[rn] -= sz ? 2 : 1;
+      adr = h8_er[rn];
+      if (sz) wr16(adr, v); else wr8(adr, v);
+      set_nz(v, sz);
+      return;
+    }
+    adr = h8_er[rn];
+    h8_er[rn] += sz ? 2 : 1;
+    break;
+  default: adr = h8_er[rn] + (int16_t)fetch(); break;  /* 0x6e, 0x6f */
+  }
+  if (store) {
+    v = sz ? r16(r) : r8(r);
+    if (sz) wr16(adr, v); else wr8(adr, v);
+  } else {
+    v = sz ? rd16(adr) : rd8(adr);
+    if (sz) w16(r, v); else w8(r, v);
+  }
+  set_nz(v, sz);
+}
+
+static void mov_abs(int hi, int b)
+     /* MOV.B / MOV.W の @aa:16, @aa:24 形式 (0x6a, 0x6b) */
+{
+  int sz = hi & 1, r = b & 0xf;
+  uint32_t adr, v;
+
+  switch (b & 0xf0) {
+  case 0x00: case 0x80: adr = (uint32_t)(int16_t)fetch(); break;
+  case 0x20: case 0xa0: adr = disp24(); break;
+  default: undefined((hi << 8) | b); return;
+  }
+  adr &= 0xffffff;
+  if (b & 0x80) {
+    v = sz ? r16(r) : r8(r);
+    if (sz) wr16(adr, v); else wr8(adr, v);
+  } else {
+    v = sz ? rd16(adr) : rd8(adr);
+    if (sz) w16(r, v); else w8(r, v);
+  }
+  set_nz(v, sz);
+}
+
+static void mov_disp24(int b)
+     /* MOV.B / MOV.W の @(d:24,ERn) 形式 (0x78) */
+{
+  uint16_t op2 = fetch();
+  int sz = (op2 >> 8) & 1, r = op2 & 0xf;
+  uint32_t adr, v;
+
+  adr = h8_er[(b >> 4) & 7] + disp24();
+  if (op2 & 0x80) {
+    v = sz ? r16(r) : r8(r);
+    if (sz) wr16(adr, v); else wr8(adr, v);
+  } else {
+    v = sz ? rd16(adr) : rd8(adr);
+    if (sz) w16(r, v); else w8(r, v);
+  }
+  set_nz(v, sz);
+}
+
+static void alu_imm(int op, int sz, int rd, uint32_t imm)
+     /* 79xx, 7Axx : MOV, ADD, CMP, SUB, OR, XOR, AND の即値形式 */
+{
+  uint32_t a = (sz == 2) ? h8_er[rd & 7] : r16(rd), r;
+
+  switch (op) {
+  case 0: r = imm; set_nz(r, sz); break;
+  case 1: r = op_add(a, imm, 0, sz, 0); break;
+  case 2: op_sub(a, imm, 0, sz, 0); return;
+  case 3: r = op_sub(a, imm, 0, sz, 0); break;
+  case 4: r = a | imm; set_nz(r, sz); break;
+  case 5: r = a ^ imm; set_nz(r, sz); break;
+  case 6: r = a & imm; set_nz(r, sz); break;
+  default: undefined(0x7900 | (op << 4)); return;
+  }
+  if (sz == 2) h8_er[rd & 7] = r; else w16(rd, r);
+}
+
+static void divxs(int sz, int rs, int rd)
+     /* DIVXS.B, DIVXS.W */
+{
+  int32_t dividend, divisor, q, rem;
+
+  if (sz == 0) {
+    dividend = (int16_t)r16(rd);
+    divisor = (int8_t)r8(rs);
+  } else {
+    dividend = (int32_t)h8_er[rd & 7];
+    divisor = (int16_t)r16(rs);
+  }
+  h8_ccr &= ~(CCR_N | CCR_Z);
+  if (divisor == 0) {
+    h8_ccr |= CCR_Z;
+    return;
+  }
+  q = dividend / divisor;
+  rem = dividend % divisor;
+  if (q < 0) h8_ccr |= CCR_N;
+  if (sz == 0) w16(rd, ((rem & 0xff) << 8) | (q & 0xff));
+  else h8_er[rd & 7] = ((uint32_t)(rem & 0xffff) << 16) | (q & 0xffff);
+}
+
+static void step(void)
+     /* 1命令を実行する */
+{
+  uint16_t op = fetch(), op2;
+  int hi = op >> 8, b = op & 0xff;
+  int rs = b >> 4, rd = b & 0xf;
+  uint32_t a, v, adr;
+  int8_t d8;
+
+  switch (hi) {
+  case 0x00: break;                                     /* NOP */
+  case 0x01:
+    switch (b) {
+    case 0x00: mov_l(); break;
+    case 0x40: ldc_stc(); break;
+    case 0x80: sleeping = 1; break;                     /* SLEEP */
+    case 0xc0:                                          /* MULXS */
+      op2 = fetch();
+      rs = (op2 >> 4) & 0xf; rd = op2 & 0xf;
+      if ((op2 >> 8) == 0x50) {
+        v = (uint16_t)((int8_t)r8(rs) * (int8_t)(r16(rd) & 0xff));
+        w16(rd, v);
+        h8_ccr &= ~(CCR_N | CCR_Z);
+        if (v & 0x8000) h8_ccr |= CCR_N;
+        if (v == 0) h8_ccr |= CCR_Z;
+        h8_states += 12;
+      } else if ((op2 >> 8) == 0x52) {
+        v = (uint32_t)((int16_t)r16(rs) * (int16_t)(h8_er[rd & 7] & 0xffff));
+        h8_er[rd & 7] = v;
+        h8_ccr &= ~(CCR_N | CCR_Z);
+        if (v & 0x80000000) h8_ccr |= CCR_N;
+        if (v == 0) h8_ccr |= CCR_Z;
+        h8_states += 20;
+      } else undefined(op2);
+      break;
+    case 0xd0:                                          /* DIVXS */
+      op2 = fetch();
+      if ((op2 >> 8) == 0x51) { divxs(0, (op2 >> 4) & 0xf, op2 & 0xf); h8_states += 12; }
+      else if ((op2 >> 8) == 0x53) { divxs(1, (op2 >> 4) & 0xf, op2 & 7); h8_states += 20; }
+      else undefined(op2);
+      break;
+    case 0xf0:                                          /* OR.L, XOR.L, AND.L */
+      op2 = fetch();
+      rs = (op2 >> 4) & 7; rd = op2 & 7;
+      switch (op2 >> 8) {
+      case 0x64: v = h8_er[rd] | h8_er[rs]; break;
+      case 0x65: v = h8_er[rd] ^ h8_er[rs]; break;
+      case 0x66: v = h8_er[rd] & h8_er[rs]; break;
+      default: undefined(op2); return;
+      }
+      h8_er[rd] = v;
+      set_nz(v, 2);
+      break;
+    default: undefined(op); break;
+    }
+    break;
+  case 0x02: w8(rd, h8_ccr); break;                     /* STC CCR,Rd */
+  case 0x03: h8_ccr = r8(rd); irq_inhibit = 1; break;   /* LDC Rs,CCR */
+  case 0x04: h8_ccr |= b; irq_inhibit = 1; break;       /* ORC */
+  case 0x05: h8_ccr ^= b; irq_inhibit = 1; break;       /* XORC */
+  case 0x06: h8_ccr &= b; irq_inhibit = 1; break;       /* ANDC */
+  case 0x07: h8_ccr = b; irq_inhibit = 1; break;        /* LDC #xx,CCR */
+  case 0x08: w8(rd, op_add(r8(rd), r8(rs), 0, 0, 0)); break;   /* ADD.B */
+  case 0x09: w16(rd, op_add(r16(rd), r16(rs), 0, 1, 0)); break; /* ADD.W */
+  case 0x0a:
+    if (rs == 0) w8(rd, op_incdec(r8(rd), 1, 0));      /* INC.B */
+    else if (rs & 8) h8_er[rd & 7] = op_add(h8_er[rd & 7], h8_er[rs & 7], 0, 2, 0);
+    else undefined(op);
+    break;
+  case 0x0b:
+    switch (rs) {
+    case 0x0: h8_er[rd & 7] += 1; break;                /* ADDS #1 */
+    case 0x8: h8_er[rd & 7] += 2; break;                /* ADDS #2 */
+    case 0x9: h8_er[rd & 7] += 4; break;                /* ADDS #4 */
+    case 0x5: w16(rd, op_incdec(r16(rd), 1, 1)); break; /* INC.W #1 */
+    case 0xd: w16(rd, op_incdec(r16(rd), 2, 1)); break; /* INC.W #2 */
+    case 0x7: h8_er[rd & 7] = op_incdec(h8_er[rd & 7], 1, 2); break;
+    case 0xf: h8_er[rd & 7] = op_incdec(h8_er[rd & 7], 2, 2); break;
+    default: undefined(op); break;
+    }
+    break;
+  case 0x0c: v = r8(rs); w8(rd, v); set_nz(v, 0); break;       /* MOV.B */
+  case 0x0d: v = r16(rs); w16(rd, v); set_nz(v, 1); break;     /* MOV.W */
+  case 0x0e: w8(rd, op_add(r8(rd), r8(rs), h8_ccr & CCR_C, 0, 1)); break;
+  case 0x0f:
+    if (rs == 0) {                                      /* DAA */
+      a = r8(rd); v = a;
+      if ((h8_ccr & CCR_H) || ((a & 0x0f) > 9)) v += 0x06;
+      if ((h8_ccr & CCR_C) || (a > 0x99)) { v += 0x60; h8_ccr |= CCR_C; }
+      w8(rd, v);
+      h8_ccr &= ~(CCR_N | CCR_Z);
+      if (v & 0x80) h8_ccr |= CCR_N;
+      if ((v & 0xff) == 0) h8_ccr |= CCR_Z;
+    } else if (rs & 8) {                                /* MOV.L ERs,ERd */
+      v = h8_er[rs & 7]; h8_er[rd & 7] = v; set_nz(v, 2);
+    } else undefined(op);
+    break;
+  case 0x10: case 0x11: case 0x12: case 0x13:          /* シフト, ローテート */
+    {
+      int kind = (hi & 3) | 0x10 | ((rs & 8) ? 0x08 : 0);
+      switch (rs & 7) {
+      case 0: w8(rd, op_shift(kind, r8(rd), 0)); break;
+      case 1: w16(rd, op_shift(kind, r16(rd), 1)); break;
+      case 3: h8_er[rd & 7] = op_shift(kind, h8_er[rd & 7], 2); break;
+      default: undefined(op); break;
+      }
+    }
+    break;
+  case 0x14: v = r8(rd) | r8(rs); w8(rd, v); set_nz(v, 0); break;
+  case 0x15: v = r8(rd) ^ r8(rs); w8(rd, v); set_nz(v, 0); break;
+  case 0x16: v = r8(rd) & r8(rs); w8(rd, v); set_nz(v, 0); break;
+  case 0x17:
+    switch (rs) {
+    case 0x0: v = ~r8(rd); w8(rd, v); set_nz(v, 0); break;      /* NOT */
+    case 0x1: v = ~r16(rd); w16(rd, v); set_nz(v, 1); break;
+    case 0x3: v = ~h8_er[rd & 7]; h8_er[rd & 7] = v; set_nz(v, 2); break;
+    case 0x5: v = r16(rd) & 0xff; w16(rd, v); set_nz(v, 1); break; /* EXTU */
+    case 0x7: v = h8_er[rd & 7] & 0xffff; h8_er[rd & 7] = v; set_nz(v, 2); break;
+    case 0x8: w8(rd, op_sub(0, r8(rd), 0, 0, 0)); break;        /* NEG */
+    case 0x9: w16(rd, op_sub(0, r16(rd), 0, 1, 0)); break;
+    case 0xb: h8_er[rd & 7] = op_sub(0, h8_er[rd & 7], 0, 2, 0); break;
+    case 0xd: v = (uint16_t)(int8_t)r16(rd); w16(rd, v); set_nz(v, 1); break; /* EXTS */
+    case 0xf: v = (uint32_t)(int16_t)h8_er[rd & 7]; h8_er[rd & 7] = v; set_nz(v, 2); break;
+    default: undefined(op); break;
+    }
+    break;
+  case 0x18: w8(rd, op_sub(r8(rd), r8(rs), 0, 0, 0)); break;   /* SUB.B */
+  case 0x19: w16(rd, op_sub(r16(rd), r16(rs), 0, 1, 0)); break; /* SUB.W */
+  case 0x1a:
+    if (rs == 0) w8(rd, op_incdec(r8(rd), -1, 0));     /* DEC.B */
+    else if (rs & 8) h8_er[rd & 7] = op_sub(h8_er[rd & 7], h8_er[rs & 7], 0, 2, 0);
+    else undefined(op);
+    break;
+  case 0x1b:
+    switch (rs) {
+    case 0x0: h8_er[rd & 7] -= 1; break;                /* SUBS #1 */
+    case 0x8: h8_er[rd & 7] -= 2; break;                /* SUBS #2 */
+    case 0x9: h8_er[rd & 7] -= 4; break;                /* SUBS #4 */
+    case 0x5: w16(rd, op_incdec(r16(rd), -1, 1)); break;
+    case 0xd: w16(rd, op_incdec(r16(rd), -2, 1)); break;
+    case 0x7: h8_er[rd & 7] = op_incdec(h8_er[rd & 7], -1, 2); break;
+    case 0xf: h8_er[rd & 7] = op_incdec(h8_er[rd & 7], -2, 2); break;
+    default: undefined(op); break;
+    }
+    break;
+  case 0x1c: op_sub(r8(rd), r8(rs), 0, 0, 0); break;   /* CMP.B */
+  case 0x1d: op_sub(r16(rd), r16(rs), 0, 1, 0); break; /* CMP.W */
+  case 0x1e: w8(rd, op_sub(r8(rd), r8(rs), h8_ccr & CCR_C, 0, 1)); break;
+  case 0x1f:
+    if (rs == 0) {                                      /* DAS */
+      a = r8(rd); v = a;
+      if (h8_ccr & CCR_H) v -= 0x06;
+      if (h8_ccr & CCR_C) v -= 0x60;
+      w8(rd, v);
+      h8_ccr &= ~(CCR_N | CCR_Z);
+      if (v & 0x80) h8_ccr |= CCR_N;
+      if ((v & 0xff) == 0) h8_ccr |= CCR_Z;
+    } else if (rs & 8) op_sub(h8_er[rd & 7], h8_er[rs & 7], 0, 2, 0); /* CMP.L */
+    else undefined(op);
+    break;
+  case 0x20: case 0x21: case 0x22: case 0x23: case 0x24: case 0x25: case 0x26: case 0x27:
+  case 0x28: case 0x29: case 0x2a: case 0x2b: case 0x2c: case 0x2d: case 0x2e: case 0x2f:
+    v = rd8(0xffff00 | b); w8(hi & 0xf, v); set_nz(v, 0); break; /* MOV.B @aa:8,Rd */
+  case 0x30: case 0x31: case 0x32: case 0x33: case 0x34: case 0x35: case 0x36: case 0x37:
+  case 0x38: case 0x39: case 0x3a: case 0x3b: case 0x3c: case 0x3d: case 0x3e: case 0x3f:
+    v = r8(hi & 0xf); wr8(0xffff00 | b, v); set_nz(v, 0); break; /* MOV.B Rs,@aa:8 */
+  case 0x40: case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x46: case 0x47:
+  case 0x48: case 0x49: case 0x4a: case 0x4b: case 0x4c: case 0x4d: case 0x4e: case 0x4f:
+    d8 = (int8_t)b;                                     /* Bcc d:8 */
+    if (cond(hi & 0xf)) h8_pc = (h8_pc + d8) & 0xffffff;
+    prefetch();
+    break;
+  case 0x50:                                            /* MULXU.B */
+    w16(rd, (r16(rd) & 0xff) * r8(rs));
+    h8_states += 12;
+    break;
+  case 0x51:                                            /* DIVXU.B */
+    a = r16(rd); v = r8(rs);
+    h8_ccr &= ~(CCR_N | CCR_Z);
+    if (v & 0x80) h8_ccr |= CCR_N;
+    if (v == 0) h8_ccr |= CCR_Z;
+    else w16(rd, ((a % v) << 8) | ((a / v) & 0xff));
+    h8_states += 12;
+    break;
+  case 0x52:                                            /* MULXU.W */
+    h8_er[rd & 7] = (h8_er[rd & 7] & 0xffff) * r16(rs);
+    h8_states += 20;
+    break;
+  case 0x53:                                            /* DIVXU.W */
+    a = h8_er[rd & 7]; v = r16(rs);
+    h8_ccr &= ~(CCR_N | CCR_Z);
+    if (v & 0x8000) h8_ccr |= CCR_N;
+    if (v == 0) h8_ccr |= CCR_Z;
+    else h8_er[rd & 7] = ((a % v) << 16) | ((a / v) & 0xffff);
+    h8_states += 20;
+    break;
+  case 0x54:                                            /* RTS */
+    prof_return();
+    h8_pc = rd32(h8_er[7]) & 0xffffff;
+    h8_er[7] += 4;
+    h8_states += 2;
+    prefetch();
+    break;
+  case 0x55:                                            /* BSR d:8 */
+    prefetch();
+    call(h8_pc + (int8_t)b);
+    break;
+  case 0x56:                                            /* RTE */
+    v = rd32(h8_er[7]);
+    h8_er[7] += 4;
+    h8_ccr = v >> 24;
+    h8_pc = v & 0xffffff;
+    h8_states += 2;
+    prefetch();
+    prof_leave_isr();
+    irq_inhibit = 0;
+    break;
+  case 0x57:                                            /* TRAPA */
+    exception(8 + ((b >> 4) & 3));
+    h8_states -= 2;                                     /* プリフェッチは I=2 */
+    prefetch();
+    break;
+  case 0x58:                                            /* Bcc d:16 */
+    v = fetch();
+    if (cond(rs)) h8_pc = (h8_pc + (int16_t)v) & 0xffffff;
+    h8_states += 2;
+    break;
+  case 0x59: h8_pc = h8_er[rs & 7] & 0xffffff; prefetch(); break; /* JMP @ERn */
+  case 0x5a: h8_pc = ((uint32_t)b << 16) | fetch(); h8_states += 2; break;
+  case 0x5b: h8_pc = rd32(b) & 0xffffff; h8_states += 2; prefetch(); break;
+  case 0x5c:                                            /* BSR d:16 */
+    v = fetch();
+    h8_states += 2;
+    call(h8_pc + (int16_t)v);
+    break;
+  case 0x5d: prefetch(); call(h8_er[rs & 7]); break;    /* JSR @ERn */
+  case 0x5e:                                            /* JSR @aa:24 */
+    adr = ((uint32_t)b << 16) | fetch();
+    h8_states += 2;
+    call(adr);
+    break;
+  case 0x5f: adr = rd32(b); prefetch(); call(adr); break; /* JSR @@aa:8 */
+  case 0x60: case 0x61: case 0x62: case 0x63:           /* Rn,Rd 形式のビット操作 */
+  case 0x67: case 0x70: case 0x71: case 0x72: case 0x73:
+  case 0x74: case 0x75: case 0x76: case 0x77:
+    {
+      int write, bit = (hi <= 0x63) ? r8(rs) : (rs & 7);
+      int inv = (hi >= 0x67) && (rs & 8);
+      v = bitop(hi, inv, bit, r8(rd), &write);
+      if (write) w8(rd, v);
+    }
+    break;
+  case 0x64: v = r16(rd) | r16(rs); w16(rd, v); set_nz(v, 1); break;
+  case 0x65: v = r16(rd) ^ r16(rs); w16(rd, v); set_nz(v, 1); break;
+  case 0x66: v = r16(rd) & r16(rs); w16(rd, v); set_nz(v, 1); break;
+  case 0x68: case 0x69: case 0x6c: case 0x6d: case 0x6e: case 0x6f:
+    mov_mem(hi, b);
+    break;
+  case 0x6a: case 0x6b: mov_abs(hi, b); break;
+  case 0x78: mov_disp24(b); break;
+  case 0x79: alu_imm(rs, 1, rd, fetch()); break;
+  case 0x7a: alu_imm(rs, 2, rd, disp24()); break;
+  case 0x7b:                                            /* EEPMOV */
+    op2 = fetch();
+    {
+      int n = (b == 0x5c) ? r8(0x0c) : r16(4);          /* R4L または R4 */
+      rd8(h8_er[5]); rd8(h8_er[6]);                     /* L=2n+2 の 2 */
+      while (n > 0) {
+        wr8(h8_er[6], rd8(h8_er[5]));
+        h8_er[5]++; h8_er[6]++; n--;
+      }
+      if (b == 0x5c) w8(0x0c, 0); else w16(4, 0);
+    }
+    break;
+  case 0x7c: case 0x7d:                                 /* @ERd のビット操作 */
+    op2 = fetch();
+    bitop_mem(h8_er[(rs) & 7], op2);
+    break;
+  case 0x7e: case 0x7f:                                 /* @aa:8 のビット操作 */
+    op2 = fetch();
+    bitop_mem(0xffff00 | b, op2);
+    break;
+  case 0x80: case 0x81: case 0x82: case 0x83: case 0x84: case 0x85: case 0x86: case 0x87:
+  case 0x88: case 0x89: case 0x8a: case 0x8b: case 0x8c: case 0x8d: case 0x8e: case 0x8f:
+    w8(hi & 0xf, op_add(r8(hi & 0xf), b, 0, 0, 0)); break;       /* ADD.B #xx */
+  case 0x90: case 0x91: case 0x92: case 0x93: case 0x94: case 0x95: case 0x96: case 0x97:
+  case 0x98: case 0x99: case 0x9a: case 0x9b: case 0x9c: case 0x9d: case 0x9e: case 0x9f:
+    w8(hi & 0xf, op_add(r8(hi & 0xf), b, h8_ccr & CCR_C, 0, 1)); break; /* ADDX #xx */
+  case 0xa0: case 0xa1: case 0xa2: case 0xa3: case 0xa4: case 0xa5: case 0xa6: case 0xa7:
+  case 0xa8: case 0xa9: case 0xaa: case 0xab: case 0xac: case 0xad: case 0xae: case 0xaf:
+    op_sub(r8(hi & 0xf), b, 0, 0, 0); break;                    /* CMP.B #xx */
+  case 0xb0: case 0xb1: case 0xb2: case 0xb3: case 0xb4: case 0xb5: case 0xb6: case 0xb7:
+  case 0xb8: case 0xb9: case 0xba: case 0xbb: case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+    w8(hi & 0xf, op_sub(r8(hi & 0xf), b, h8_ccr & CCR_C, 0, 1)); break; /* SUBX #xx */
+  case 0xc0: case 0xc1: case 0xc2: case 0xc3: case 0xc4: case 0xc5: case 0xc6: case 0xc7:
+  case 0xc8: case 0xc9: case 0xca: case 0xcb: case 0xcc: case 0xcd: case 0xce: case 0xcf:
+    v = r8(hi & 0xf) | b; w8(hi & 0xf, v); set_nz(v, 0); break; /* OR.B #xx */
+  case 0xd0: case 0xd1: case 0xd2: case 0xd3: case 0xd4: case 0xd5: case 0xd6: case 0xd7:
+  case 0xd8: case 0xd9: case 0xda: case 0xdb: case 0xdc: case 0xdd: case 0xde: case 0xdf:
+    v = r8(hi & 0xf) ^ b; w8(hi & 0xf, v); set_nz(v, 0); break; /* XOR.B #xx */
+  case 0xe0: case 0xe1: case 0xe2: case 0xe3: case 0xe4: case 0xe5: case 0xe6: case 0xe7:
+  case 0xe8: case 0xe9: case 0xea: case 0xeb: case 0xec: case 0xed: case 0xee: case 0xef:
+    v = r8(hi & 0xf) & b; w8(hi & 0xf, v); set_nz(v, 0); break; /* AND.B #xx */
+  default:                                                      /* MOV.B #xx */
+    w8(hi & 0xf, b); set_nz(b, 0); break;
+  }
+}
+
+/*
+ * 実行制御
+ */
+
+void h8_reset(uint32_t entry, int from_loader)
+{
+  int ch;
+
+  memset(h8_er, 0, sizeof(h8_er));
+  memset(io, 0, sizeof(io));
+  memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+  memset(h8_vec_prof, 0, sizeof(h8_vec_prof));
+  memset(nested_states, 0, sizeof(nested_states));
+  lcd_addr = 0;
+  lcd_inc = 1;
+  h8_states = 0;
+  h8_insns = 0;
+  h8_error = 0;
+  h8_dma_count = 0;
+  h8_dma_states = 0;
+  sleeping = 0;
+  irq_inhibit = 0;
+  isr_sp = func_sp = 0;
+
+  /* リセット後の値 */
+  io[IO_SYSCR] = 0x09;
+  io[IO_ABWCR] = 0xff;
+  io[IO_ASTCR] = 0xff;
+  io[IO_WCRH] = 0xff;
+  io[IO_WCRL] = 0xff;
+  io[IO_RAMCR] = 0xf1;
+  io[IO_RTCOR] = 0xff;
+  io[IO_TSTR] = 0xf8;
+  io[IO_TISRA] = io[IO_TISRB] = io[IO_TISRC] = 0x88;
+  for (ch = 0; ch < 3; ch++) {
+    io[IO_ITU0 + 8 * ch] = 0x80;
+    io[IO_ITU0 + 8 * ch + 4] = io[IO_ITU0 + 8 * ch + 5] = 0xff;
+    io[IO_ITU0 + 8 * ch + 6] = io[IO_ITU0 + 8 * ch + 7] = 0xff;
+    itu[ch].last = 0;
+    itu[ch].event = ~(uint64_t)0;
+  }
+  io[IO_ADCR] = 0x7f;
+  io[IO_P6DR] = 0x80;
+  ad_event = ~(uint64_t)0;
+  t8_base = 0;
+  t8_event = ~(uint64_t)0;
+
+  if (from_loader) {
+    /* S フォーマットローダ(ROM版, romcrt-ext.s)が設定した状態 */
+    io[IO_SYSCR] = 0x09;
+    io[IO_RAMCR] = 0xf0;
+    io[IO_ABWCR] = 0xff;          /* 外部エリアは全て8ビット幅 */
+    io[IO_ASTCR] = 0xff;          /* 外部エリアは全て3ステートアクセス */
+    io[IO_WCRH] = io[IO_WCRL] = 0;  /* ウェイトなし */
+    io[IO_BCR] = 0xc6;
+    io[IO_RTCOR] = 149;
+    io[IO_RTMCSR] = 0x0f;
+    io[IO_DRCRA] = 0x30;
+    h8_er[7] = 0xffff20;          /* ローダのスタック */
+    h8_ccr = CCR_I;
+    bus_map();
+    h8_pc = entry & 0xffffff;
+  } else {
+    h8_ccr = CCR_I;
+    bus_map();
+    h8_pc = rd32(0) & 0xffffff;
+    h8_states = 0;
+  }
+  periph_schedule();
+  irq_update();
+}
+
+void h8_run(uint64_t until)
+{
+  while ((h8_states < until) && !h8_error) {
+    if (h8_states >= next_event) periph_events();
+    if (irq_inhibit) {
+      irq_inhibit = 0;
+    } else if ((irq_vec >= 0) && irq_acceptable()) {
+      exception(irq_vec);
+      continue;
+    }
+    if (sleeping) {
+      /* 割り込みが来るまで時間を進める */
+      h8_states = (next_event < until) ? next_event : until;
+      continue;
+    }
+    step();
+    h8_insns++;
+  }
+}
@@ -0,0 +1,75 @@
+/* sim/h8iss.h */
+/* H8/300H (アドバンストモード) 命令セットシミュレータ (make iss) */
+/*   H8/3069F の CPU, バスコントローラ, 割り込みコントローラ,     */
+/*   ITU(16ビットタイマ) ch0-2, 8ビットタイマの出力, A/D変換器,     */
+/*   A/D変換終了で起動する DMAC(ショートアドレスモード),            */
+/*   ポートA/4/6/B を模擬する                                      */
+/*   実行ステート数は命令フェッチとデータアクセスごとに,           */
+/*   アクセス先のエリアのバス幅とアクセスステート数から数える       */
+
+#include <stdint.h>
+
+/* CPUクロック[Hz] */
+#define H8_PHI 25000000.0
+
+/* アドレス空間 */
+#define H8_ROM_START   0x000000
+#define H8_ROM_SIZE    0x080000
+#define H8_XRAM_START  0x400000   /* 外部RAM(DRAM, エリア2) */
+#define H8_XRAM_SIZE   0x200000
+#define H8_IRAM_START  0xffbf20   /* 内蔵RAM */
+#define H8_IRAM_SIZE   0x004000
+
+/* 割り込みベクタ番号 (リンカスクリプト h8-3069-*.x の並びに合わせる) */
+#define H8_VEC_ADI     23
+#define H8_VEC_IMIA0   24
+#define H8_VEC_IMIB0   25
+#define H8_VEC_OVI0    26
+#define H8_VEC_NUM     64
+
+/* ISR や関数ごとの実行ステート数の集計 */
+struct h8_prof {
+  unsigned long calls;
+  uint64_t total;       /* 呼び出しから戻るまで(入れ子の割り込みを含む) */
+  uint64_t self;        /* 入れ子の割り込みの分を除いたもの */
+  uint64_t min, max;    /* self の最小, 最大 */
+  uint64_t first;       /* 最初に呼ばれた h8_states (呼ばれていなければ 0) */
+};
+
+/* CPU とシミュレーションの状態 */
+extern uint32_t h8_er[8];
+extern uint32_t h8_pc;
+extern uint8_t h8_ccr;
+extern uint64_t h8_states;          /* リセットからの経過ステート数 */
+extern unsigned long h8_insns;      /* 実行した命令数 */
+extern int h8_error;                /* 未定義命令などで停止したとき 1 */
+extern unsigned long h8_dma_count;  /* DMAC の転送回数 */
+extern uint64_t h8_dma_states;      /* DMAC の転送で CPU を止めたステート数 */
+
+/* 周辺との接続 (iss.c が設定する) */
+extern int (*h8_adc_input)(int ch);         /* A/D 入力(10ビット)を返す */
+extern void (*h8_output_write)(void);
+     /* ポートBまたは8ビットタイマの出力の設定が変化した */
+
+/* ISR と関数の集計 */
+extern struct h8_prof h8_vec_prof[H8_VEC_NUM];
+extern struct h8_prof *(*h8_func_prof)(uint32_t adr);
+     /* 関数の先頭アドレスから集計先を返す(集計しないときは NULL) */
+
+extern void h8_reset(uint32_t entry, int from_loader);
+     /* CPU と周辺を初期化する                                       */
+     /*   from_loader = 1 : S フォーマットローダから entry が呼ばれた状態 */
+     /*                    (romcrt-ext.s によるバス設定が済んでいる)    */
+     /*   from_loader = 0 : リセットベクタから実行する                   */
+extern int h8_load(uint32_t adr, const uint8_t *data, uint32_t len);
+     /* メモリにデータを書き込む(ROM 領域も書ける), 範囲外なら -1 */
+extern uint8_t h8_peek8(uint32_t adr);
+extern void h8_poke8(uint32_t adr, uint8_t v);
+     /* ステート数を数えずにメモリを読み書きする */
+extern void h8_run(uint64_t until);
+     /* h8_states が until になるまで(またはエラーまで)実行する */
+extern double h8_portb_duty(int bit);
+     /* ポートBの端子 PBn の出力の平均値(0-1)                  */
+     /* PB0-3 は8ビットタイマの PWM 出力ならそのデューティを返す */
+extern void h8_lcd_line(int row, char *buf);
+     /* LCD(HD44780 互換 16x2)の表示内容(16文字+NUL)を返す */
@@ -0,0 +1,618 @@
+/*   ライントレーサ制御プログラムの命令セットシミュレータ (make iss)     */
+/*   クロスコンパイルした linetracer.mot(S フォーマット) または         */
+/*   linetracer.coff を sim/h8iss.c の H8/300H で実行し, ポートBの出力 */
+/*   で sim/robot.c のロボットを走らせる(閉ループ)                     */
+/*   make sim と違い, 実機と同じ命令列を実行ステート数つきで動かすので, */
+/*   割り込みハンドラや関数ごとの実行ステート数を測ることができる      */
+/*   使い方は linetracer-iss -h を参照                                   */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "h8iss.h"
+#include "robot.h"
+
+/* 基板上のモータドライバの接続(ポートBのビット番号) */
+#define LMOTOR_IN1   0
+#define LMOTOR_IN2   1
+#define RMOTOR_IN1   2
+#define RMOTOR_IN2   3
+
+/* ロボットの状態を確かめる間隔[ステート] (100us) */
+#define ISS_STEP     2500
+
+/* センサのしきい値の初期値 (linetracer.c の sensor_limit_1, _2) */
+#define ISS_LIMIT_BLACK 0x360
+#define ISS_LIMIT_WHITE 0x2b8
+
+/* 走行開始の変数を書き込む時刻[ms] (LCD の初期化が終わった後) */
+#define ISS_START_MS 200
+
+/* 横ずれがこれを越えたらコースアウトとしてシミュレーションを終える[m] */
+#define ISS_OFFTRACK 0.15
+
+/* シンボル */
+#define SYM_MAX 4096
+struct symbol {
+  char name[64];
+  uint32_t adr;
+};
+static struct symbol sym[SYM_MAX];
+static int sym_num;
+
+/* 集計する関数 */
+#define FUNC_MAX 32
+static const char *func_default[] = {
+  "key_sense", "ad_filter", "ad_latest", "filter_put", "ad_read",
+  "motor_set", "sensor_update", "est_update", "trace_update", "hist_popcount", "control_proc", "sched_tick", NULL
+};
+static const char *func_name[FUNC_MAX];
+static uint32_t func_adr[FUNC_MAX];
+static struct h8_prof func_prof[FUNC_MAX];
+static int func_num;
+
+/* リセットから最初に呼ばれるまでの時間を表示する関数 */
+#define BOOT_FUNC_NUM 2
+static const char *boot_func[BOOT_FUNC_NUM] = { "main", "control_proc" };
+static uint32_t boot_adr[BOOT_FUNC_NUM];
+static struct h8_prof boot_prof[BOOT_FUNC_NUM];  /* 集計する関数にないとき */
+
+/* ファームウェアが記録する起動の時刻 (linetracer.c の boot_time[], BOOT_*) */
+static const char *boot_name[] = { "intrinit", "control", "lcd", NULL };
+
+/* 実行中に書き込む変数 (-s name[:size]=value[@ms]) */
+#define SET_MAX 32
+struct setting {
+  char name[64];
+  int size;             /* 変数のバイト数 (1, 2, 4) */
+  uint32_t value;
+  uint64_t at;          /* 書き込む時刻[ステート] */
+  int done;
+};
+static struct setting set[SET_MAX];
+static int set_num;
+
+/* ロボット */
+static struct robot robot;
+static uint64_t robot_states;   /* ロボットを進めた時刻 */
+static double duty_l, duty_r;     /* デューティ(正:正転, 負:逆転) */
+static double duty_sum_l, duty_sum_r; /* デューティ x ステート数の累計 */
+
+static void add_symbol(const char *name, uint32_t adr)
+{
+  if (sym_num >= SYM_MAX) return;
+  if (name[0] == '_') name++;   /* C のシンボルは先頭に _ が付く */
+  strncpy(sym[sym_num].name, name, sizeof(sym[0].name) - 1);
+  sym[sym_num].adr = adr & 0xffffff;
+  sym_num++;
+}
+
+static int find_symbol(const char *name, uint32_t *adr)
+{
+  int i;
+
+  for (i = 0; i < sym_num; i++) {
+    if (strcmp(sym[i].name, name) == 0) {
+      *adr = sym[i].adr;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * ファイルの読み込み
+ */
+
+static int hexval(const char *s, int n)
+{
+  int v = 0, c;
+
+  while (n-- > 0) {
+    c = *s++;
+    if ((c >= '0') && (c <= '9')) c -= '0';
+    else if ((c >= 'A') && (c <= 'F')) c -= 'A' - 10;
+    else if ((c >= 'a') && (c <= 'f')) c -= 'a' - 10;
+    else return -1;
+    v = (v << 4) | c;
+  }
+  return v;
+}
+
+static int load_srec(FILE *fp, uint32_t *entry, int *has_vectors)
+     /* S フォーマットを読み込む関数 (S1/S2/S3 と S7/S8/S9) */
+{
+  char line[600];
+  uint8_t data[256];
+  int type, count, alen, i, v, lineno = 0;
+  uint32_t adr;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    lineno++;
+    if (line[0] != 'S') continue;
+    type = line[1] - '0';
+    count = hexval(line + 2, 2);
+    switch (type) {
+    case 1: case 9: alen = 2; break;
+    case 2: case 8: alen = 3; break;
+    case 3: case 7: alen = 4; break;
+    default: continue;                  /* S0, S5 など */
+    }
+    if (count < alen + 1) goto bad;
+    adr = 0;
+    for (i = 0; i < alen; i++) {
+      v = hexval(line + 4 + 2 * i, 2);
+      if (v < 0) goto bad;
+      adr = (adr << 8) | v;
+    }
+    if (type >= 7) {
+      *entry = adr;
+      continue;
+    }
+    for (i = 0; i < count - alen - 1; i++) {
+      v = hexval(line + 4 + 2 * (alen + i), 2);
+      if (v < 0) goto bad;
+      data[i] = v;
+    }
+    if (h8_load(adr, data, count - alen - 1) < 0) {
+      fprintf(stderr, "line %d: address %06x is out of memory\n", lineno, adr);
+      return -1;
+    }
+    if (adr < 0x100) *has_vectors = 1;
+  }
+  return 0;
+ bad:
+  fprintf(stderr, "line %d: bad S record\n", lineno);
+  return -1;
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint16_t be16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+static int load_coff(FILE *fp, uint32_t *entry, int *has_vectors)
+     /* coff-h8300 形式を読み込む関数 (セクションとシンボル) */
+{
+  uint8_t *buf, *sh, *se, *strtab;
+  long size;
+  uint32_t symptr, nsyms, paddr, ssize, scnptr, flags, strsize, i;
+  int nscns, opthdr, n;
+  char name[64];
+
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  buf = malloc(size);
+  if ((buf == NULL) || (fread(buf, 1, size, fp) != (size_t)size)) return -1;
+  nscns = be16(buf + 2);
+  symptr = be32(buf + 8);
+  nsyms = be32(buf + 12);
+  opthdr = be16(buf + 16);
+  if (opthdr >= 28) *entry = be32(buf + 20 + 16);
+
+  for (n = 0; n < nscns; n++) {
+    sh = buf + 20 + opthdr + 40 * n;
+    if (sh + 40 > buf + size) break;
+    paddr = be32(sh + 8);
+    ssize = be32(sh + 16);
+    scnptr = be32(sh + 20);
+    flags = be32(sh + 36);
+    if ((ssize == 0) || (scnptr == 0) || (flags & 0x80)) continue; /* .bss */
+    if ((strncmp((char *)sh, ".stab", 5) == 0) ||
+        (strncmp((char *)sh, ".debug", 6) == 0) ||
+        (strncmp((char *)sh, ".comment", 8) == 0)) continue;
+    if ((scnptr + ssize > (uint32_t)size) || (h8_load(paddr, buf + scnptr, ssize) < 0)) {
+      fprintf(stderr, "section %.8s: cannot load at %06x\n", (char *)sh, paddr);
+      free(buf);
+      return -1;
+    }
+    if (paddr < 0x100) *has_vectors = 1;
+  }
+
+  if ((symptr != 0) && (symptr + 18 * nsyms + 4 <= (uint32_t)size)) {
+    strtab = buf + symptr + 18 * nsyms;
+    strsize = be32(strtab);
+    for (i = 0; i < nsyms; i++) {
+      se = buf + symptr + 18 * i;
+      if (be32(se) == 0) {
+        if (be32(se + 4) >= strsize) continue;
+        strncpy(name, (char *)strtab + be32(se + 4), sizeof(name) - 1);
+      } else {
+        memcpy(name, se, 8);
+        name[8] = '\0';
+      }
+      name[sizeof(name) - 1] = '\0';
+      if ((se[16] == 2) || (se[16] == 3)) /* C_EXT, C_STAT */
+        if ((int16_t)be16(se + 12) > 0) add_symbol(name, be32(se + 8));
+      i += se[17];                       /* 補助エントリ */
+    }
+  }
+  free(buf);
+  return 0;
+}
+
+static int load_map(const char *file)
+     /* リンカのマップファイル(-Wl,-Map)からシンボルを読む関数 */
+{
+  FILE *fp;
+  char line[512], name[256];
+  unsigned long adr;
+
+  fp = fopen(file, "r");
+  if (fp == NULL) {
+    perror(file);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, " 0x%lx %255s", &adr, name) != 2) continue;
+    if ((name[0] != '_') || (strchr(line, '=') != NULL)) continue;
+    add_symbol(name, adr);
+  }
+  fclose(fp);
+  return 0;
+}
+
+/*
+ * 周辺との接続
+ */
+
+static void robot_advance(void)
+     /* 現在の駆動状態でロボットを現在時刻まで動かす関数 */
+{
+  uint64_t d = h8_states - robot_states;
+
+  if (d == 0) return;
+  robot_step_duty(&robot, duty_l, duty_r, d / H8_PHI);
+  duty_sum_l += duty_l * d;
+  duty_sum_r += duty_r * d;
+  robot_states = h8_states;
+}
+
+static void output_write(void)
+     /* モータの出力が変わったら, それまでの駆動状態でロボットを動かす */
+     /* IN1=IN2=1 のブレーキは使わないので惰性として扱う               */
+{
+  robot_advance();
+  duty_l = h8_portb_duty(LMOTOR_IN1) - h8_portb_duty(LMOTOR_IN2);
+  duty_r = h8_portb_duty(RMOTOR_IN1) - h8_portb_duty(RMOTOR_IN2);
+}
+
+static int adc_input(int ch)
+{
+  robot_advance();
+  return robot_sense(&robot, ch);
+}
+
+static struct h8_prof *func_lookup(uint32_t adr)
+{
+  int i;
+
+  for (i = 0; i < func_num; i++)
+    if (func_adr[i] == adr) return &func_prof[i];
+  for (i = 0; i < BOOT_FUNC_NUM; i++)
+    if (boot_adr[i] == adr) return &boot_prof[i];
+  return NULL;
+}
+
+static void write_var(uint32_t adr, uint32_t v, int size)
+     /* size バイト(ビッグエンディアン)の変数を書き換える */
+{
+  int i;
+
+  for (i = 0; i < size; i++)
+    h8_poke8(adr + i, v >> (8 * (size - 1 - i)));
+}
+
+static uint32_t read_var(uint32_t adr, int size)
+     /* size バイト(ビッグエンディアン)の変数を読む */
+{
+  uint32_t v = 0;
+  int i;
+
+  for (i = 0; i < size; i++) v = (v << 8) | h8_peek8(adr + i);
+  return v;
+}
+
+static void print_boot(void)
+     /* 起動にかかった時間を表示する                              */
+     /*   リセットから main(), control_proc() が呼ばれるまで (ISS) */
+     /*   タイマ0を動かしてからの boot_time[] (ファームウェア)      */
+{
+  struct h8_prof *p;
+  uint32_t adr;
+  int i, n;
+
+  for (i = n = 0; i < BOOT_FUNC_NUM; i++)
+    if (boot_adr[i] != (uint32_t)~0) n++;
+  if (n == 0) return;    /* シンボルがない */
+  printf("boot          :");
+  for (i = 0; i < BOOT_FUNC_NUM; i++) {
+    if (boot_adr[i] == (uint32_t)~0) continue;
+    p = func_lookup(boot_adr[i]);
+    if (p->first == 0) printf(" %s -", boot_func[i]);
+    else printf(" %s %.3f ms", boot_func[i], p->first * 1000.0 / H8_PHI);
+  }
+  printf(" (リセットから)\n");
+  if (!find_symbol("boot_time", &adr)) return;
+  printf("boot_time     :");
+  for (i = 0; boot_name[i] != NULL; i++)
+    printf(" %s %.3f ms", boot_name[i], read_var(adr + 4 * i, 4) / 1000.0);
+  printf(" (タイマ0から)\n");
+}
+
+static void add_setting(const char *name, int size, uint32_t value, double ms)
+{
+  int i;
+
+  for (i = 0; i < set_num; i++)
+    if ((strcmp(set[i].name, name) == 0) && (set[i].at == (uint64_t)(ms * H8_PHI / 1000.0)))
+      break;
+  if (i >= SET_MAX) return;
+  strncpy(set[i].name, name, sizeof(set[0].name) - 1);
+  set[i].size = size;
+  set[i].value = value;
+  set[i].at = (uint64_t)(ms * H8_PHI / 1000.0);
+  set[i].done = 0;
+  if (i == set_num) set_num++;
+}
+
+/*
+ * 結果の表示
+ */
+
+static const char *vec_name(int vec)
+{
+  static char buf[16];
+
+  switch (vec) {
+  case H8_VEC_ADI:   return "int_adi";
+  case H8_VEC_IMIA0: return "int_imia0";
+  case H8_VEC_IMIB0: return "int_imib0";
+  case H8_VEC_OVI0:  return "int_ovi0";
+  case H8_VEC_IMIA0 + 4: return "int_imia1";
+  case H8_VEC_IMIA0 + 8: return "int_imia2";
+  default:
+    sprintf(buf, "vector %d", vec);
+    return buf;
+  }
+}
+
+static void print_prof(const char *name, const struct h8_prof *p, double sec)
+{
+  if (p->calls == 0) {
+    printf("  %-14s %8s\n", name, "-");
+    return;
+  }
+  printf("  %-14s %8lu %9.1f %9.1f %7llu %7llu %6.2f%%\n", name, p->calls,
+         (double)p->self / p->calls, (double)p->total / p->calls,
+         (unsigned long long)p->min, (unsigned long long)p->max,
+         sec > 0 ? 100.0 * p->self / (sec * H8_PHI) : 0.0);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [options] linetracer.mot|linetracer.coff\n"
+    "  -m file   シンボルを読むマップファイル (S フォーマットのとき)\n"
+    "  -t sec    シミュレーションする時間[s] (20)\n"
+    "  -n laps   指定周回数を走ったら終了 (0:時間まで)\n"
+    "  -s name[:size]=value[@ms]  ms[ms]の時点で size バイト(既定 4)の\n"
+    "            変数に値を書き込む\n"
+    "            (既定: global_state:1=1, sensor_limit:2 を %dms で)\n"
+    "  -R        S フォーマットローダを経ずにリセットベクタから実行する\n"
+    "  -f list   ステート数を集計する関数 (カンマ区切り)\n"
+    "  -N noise  A/D 値のノイズ振幅[LSB, 10ビット] (8)\n"
+    "  -v vmax   デューティ100%%の速度[m/s] (0.4)\n"
+    "  -g s,len  s[m]の位置から len[m]だけ線を途切れさせる\n"
+    "  -S seed   ノイズの乱数の種 (1)\n"
+    "  -q        周回ごとの表示をしない\n",
+    prog, ISS_START_MS);
+}
+
+int main(int argc, char **argv)
+{
+  struct track track;
+  struct robot_param param;
+  const char *map_name = NULL, *image_name;
+  char *func_list = NULL, *p, name[64], line[17];
+  double sim_time = 20.0, t, len, max_offset, lap_start, best_lap, wall, ms;
+  unsigned long seed = 1;
+  int laps_limit = 0, quiet = 0, reset = 0, has_vectors = 0;
+  int laps, lost, lost_count, offtrack, i, c, limit, size, user_set = 0;
+  uint32_t entry = 0, adr, value;
+  uint64_t end;
+  struct timespec ts0, ts1;
+  FILE *fp;
+
+  track_default(&track);
+  robot_param_default(&param);
+
+  while ((c = getopt(argc, argv, "m:t:n:s:Rf:N:v:g:S:qh")) != -1) {
+    switch (c) {
+    case 'm': map_name = optarg; break;
+    case 't': sim_time = atof(optarg); break;
+    case 'n': laps_limit = atoi(optarg); break;
+    case 's':
+      ms = 0.0;
+      size = 4;
+      if ((sscanf(optarg, "%63[^=:]", name) != 1) ||
+          (((p = strchr(optarg, ':')) != NULL) &&
+           ((sscanf(p + 1, "%d", &size) != 1) || (size != 1 && size != 2 && size != 4))) ||
+          ((p = strchr(optarg, '=')) == NULL) || (sscanf(p + 1, "%i", (int *)&value) != 1) ||
+          (((p = strchr(optarg, '@')) != NULL) && (sscanf(p + 1, "%lf", &ms) != 1))) {
+        usage(argv[0]);
+        return 1;
+      }
+      add_setting(name, size, value, ms);
+      user_set = 1;
+      break;
+    case 'R': reset = 1; break;
+    case 'f': func_list = optarg; break;
+    case 'N': param.ad_noise = atoi(optarg); break;
+    case 'v': param.vmax = atof(optarg); break;
+    case 'g':
+      if (sscanf(optarg, "%lf,%lf", &track.gap_start, &track.gap_length) != 2) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'S': seed = strtoul(optarg, NULL, 0); break;
+    case 'q': quiet = 1; break;
+    default:  usage(argv[0]); return 1;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  image_name = argv[optind];
+
+  /* メモリの内容は h8_reset() では消えないので先に読み込む */
+  h8_reset(0, 1);
+  fp = fopen(image_name, "rb");
+  if (fp == NULL) {
+    perror(image_name);
+    return 1;
+  }
+  c = fgetc(fp);
+  rewind(fp);
+  if (c == 'S') i = load_srec(fp, &entry, &has_vectors);
+  else i = load_coff(fp, &entry, &has_vectors);
+  fclose(fp);
+  if (i < 0) return 1;
+  if ((map_name != NULL) && (load_map(map_name) < 0)) return 1;
+  if ((entry == 0) && !find_symbol("start", &entry) && !has_vectors) {
+    fprintf(stderr, "%s: no entry point\n", image_name);
+    return 1;
+  }
+
+  /* 集計する関数 */
+  if (func_list != NULL) {
+    for (p = strtok(func_list, ","); (p != NULL) && (func_num < FUNC_MAX); p = strtok(NULL, ","))
+      func_name[func_num++] = p;
+  } else {
+    for (i = 0; func_default[i] != NULL; i++) func_name[func_num++] = func_default[i];
+  }
+  for (i = 0; i < func_num; i++)
+    if (!find_symbol(func_name[i], &func_adr[i])) func_adr[i] = ~0;
+  for (i = 0; i < BOOT_FUNC_NUM; i++)
+    if (!find_symbol(boot_func[i], &boot_adr[i])) boot_adr[i] = ~0;
+  h8_func_prof = func_lookup;
+
+  /* メニューで設定する値 (-s で上書きできる) */
+  if (!user_set) {
+    limit = (ISS_LIMIT_BLACK + ISS_LIMIT_WHITE) / 2;
+    add_setting("sensor_limit", 2, limit, ISS_START_MS);
+    add_setting("global_state", 1, 1, ISS_START_MS);
+  }
+  for (i = 0; i < set_num; i++) {
+    if (!find_symbol(set[i].name, &adr)) {
+      fprintf(stderr, "warning: symbol %s not found (use -m or the .coff)\n",
+              set[i].name);
+      set[i].done = 1;
+    }
+  }
+
+  robot_init(&robot, &track, &param, seed);
+  h8_adc_input = adc_input;
+  h8_output_write = output_write;
+  h8_reset(entry, !(reset || (has_vectors && (entry == 0))));
+  robot_states = 0;
+  duty_l = duty_r = 0.0;
+
+  len = track_length(&track);
+  end = (uint64_t)(sim_time * H8_PHI);
+  laps = lost = lost_count = offtrack = 0;
+  max_offset = lap_start = best_lap = 0.0;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts0);
+  while ((h8_states < end) && !h8_error) {
+    for (i = 0; i < set_num; i++) {
+      if (!set[i].done && (h8_states >= set[i].at)) {
+        find_symbol(set[i].name, &adr);
+        write_var(adr, set[i].value, set[i].size);
+        set[i].done = 1;
+      }
+    }
+    h8_run(h8_states + ISS_STEP);
+    robot_advance();
+    t = h8_states / H8_PHI;
+
+    /* 両方のセンサがラインから外れたらライン喪失 */
+    if (fabs(robot.offset) > fabs(param.sensor_y[1]) + param.sensor_radius
+                             + track.line_width / 2.0) {
+      if (!lost) lost_count++;
+      lost = 1;
+    } else {
+      lost = 0;
+    }
+    if (fabs(robot.offset) > max_offset) max_offset = fabs(robot.offset);
+    if (fabs(robot.offset) > ISS_OFFTRACK) {
+      offtrack = 1;
+      break;
+    }
+    if (robot.progress >= (laps + 1) * len) {
+      laps++;
+      if (!quiet) printf("lap %d: %.3f s\n", laps, t - lap_start);
+      if ((best_lap == 0.0) || (t - lap_start < best_lap)) best_lap = t - lap_start;
+      lap_start = t;
+      if ((laps_limit > 0) && (laps >= laps_limit)) break;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts1);
+  wall = (ts1.tv_sec - ts0.tv_sec) + (ts1.tv_nsec - ts0.tv_nsec) / 1e9;
+  t = h8_states / H8_PHI;
+
+  printf("time          : %.3f s (%llu states, %lu instructions)\n",
+         t, (unsigned long long)h8_states, h8_insns);
+  if (h8_error) printf("stopped       : pc=%06x\n", h8_pc);
+  printf("laps          : %d", laps);
+  if (best_lap > 0.0) printf(" (best %.3f s)", best_lap);
+  printf("\n");
+  printf("distance      : %.3f m\n", robot.progress);
+  printf("line lost     : %d\n", lost_count);
+  printf("max offset    : %.1f mm%s\n", max_offset * 1000.0,
+         offtrack ? " (off track)" : "");
+  if (h8_dma_count > 0)
+    printf("dma           : %lu transfers, %llu states (%.2f%%)\n",
+           h8_dma_count, (unsigned long long)h8_dma_states,
+           100.0 * h8_dma_states / h8_states);
+  if (h8_states > 0)
+    printf("mean duty L/R : %.3f / %.3f\n",
+           duty_sum_l / h8_states, duty_sum_r / h8_states);
+  for (i = 0; i < 2; i++) {
+    h8_lcd_line(i, line);
+    printf("lcd %d         : [%s]\n", i, line);
+  }
+  print_boot();
+
+  printf("\n  %-14s %8s %9s %9s %7s %7s %7s\n",
+         "interrupt", "calls", "self", "total", "min", "max", "load");
+  for (i = 0; i < H8_VEC_NUM; i++)
+    if (h8_vec_prof[i].calls > 0) print_prof(vec_name(i), &h8_vec_prof[i], t);
+  printf("\n  %-14s %8s %9s %9s %7s %7s %7s\n",
+         "function", "calls", "self", "total", "min", "max", "load");
+  for (i = 0; i < func_num; i++) {
+    if (func_adr[i] == (uint32_t)~0) {
+      printf("  %-14s %8s\n", func_name[i], "(no symbol)");
+      continue;
+    }
+    print_prof(func_name[i], &func_prof[i], t);
+  }
+  printf("  (self/total/min/max: states, 1 state = %.0f ns)\n\n", 1e9 / H8_PHI);
+
+  printf("speed         : %.1f MIPS (%.1fx real time)\n",
+         wall > 0 ? h8_insns / wall / 1e6 : 0.0, wall > 0 ? t / wall : 0.0);
+  if (h8_error) return 3;
+  return offtrack ? 2 : 0;
+}
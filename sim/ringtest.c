@@ -0,0 +1,136 @@
+/*   ring.h のマクロのホスト上の検査 (make ringtest)                  */
+/*   窓とキューの読み書き, 書き込み数 head, tail が16ビットを一周する */
+/*   ときの添字, 負の添字の ring_wrap() を調べる                      */
+/*   大きさが2のべき乗でないときのエラーは, Makefile が RING_BADSIZE  */
+/*   を定義してコンパイルが失敗することで調べる                       */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ring.h"
+
+#define TEST_SIZE 8
+#define TEST_OPS  200000L
+
+#ifdef RING_BADSIZE
+RING(int, 12) bad;           /* コンパイルエラーになること */
+#endif
+
+struct pair {
+  unsigned short r, l;
+};
+
+static int checks, fails;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static void check(int ok, const char *what, int line)
+     /* 検査の結果を数え, 失敗したら表示する関数 */
+{
+  checks++;
+  if (!ok) {
+    fails++;
+    printf("ringtest.c:%d: %s\n", line, what);
+  }
+}
+
+static void test_window(unsigned short start)
+     /* 窓: ring_put() で上書きし, ring_last(), ring_at() で最新から読む */
+     /* start から書き込み数を数えて, head が一周する場合も調べる         */
+{
+  RING(unsigned short, TEST_SIZE) w;
+  unsigned short h;
+  int i, n;
+
+  CHECK(ring_size(&w) == TEST_SIZE);
+  w.head = w.tail = start;
+  for (n = 0; n < 3 * TEST_SIZE; n++) {
+    ring_put(&w, n);
+    for (i = 0; (i < TEST_SIZE) && (i <= n); i++) CHECK(ring_last(&w, i) == n - i);
+  }
+  h = ring_head(&w);
+  ring_put(&w, 1000);        /* h を覚えた後の書き込みは ring_at() に影響しない */
+  for (i = 0; i < TEST_SIZE - 1; i++) CHECK(ring_at(&w, h, i) == n - 1 - i);
+  CHECK(ring_last(&w, 0) == 1000);
+}
+
+static void test_queue(unsigned short start)
+     /* キュー: ring_full(), ring_empty() を見ながら出し入れし, 配列で */
+     /* 作った FIFO と同じ順で取り出せること                            */
+{
+  RING(struct pair, TEST_SIZE) q;
+  unsigned short ref[TEST_SIZE];
+  int in, out, count, i;
+  long op;
+  struct pair p;
+
+  ring_init(&q);
+  CHECK(ring_empty(&q) && (ring_count(&q) == 0));
+  q.head = q.tail = start;
+  CHECK(ring_empty(&q) && !ring_full(&q));
+
+  /* いっぱいになるまで入れて, 全部取り出す */
+  for (i = 0; i < TEST_SIZE; i++) {
+    CHECK(!ring_full(&q));
+    ring_slot(&q).r = i;
+    ring_slot(&q).l = ~i;
+    CHECK(ring_count(&q) == i);  /* ring_publish() までは見えない */
+    ring_publish(&q);
+  }
+  CHECK(ring_full(&q) && (ring_count(&q) == TEST_SIZE));
+  for (i = 0; i < TEST_SIZE; i++) {
+    CHECK(!ring_empty(&q));
+    p = ring_front(&q);
+    CHECK((p.r == i) && (p.l == (unsigned short)~i));
+    ring_pop(&q);
+  }
+  CHECK(ring_empty(&q));
+
+  /* 乱数で出し入れする (head, tail は何度も一周する) */
+  in = out = count = 0;
+  srand(start);
+  for (op = 0; op < TEST_OPS; op++) {
+    if (rand() & 1) {
+      if (ring_full(&q)) {
+        CHECK(count == TEST_SIZE);
+        continue;
+      }
+      p.r = in;
+      p.l = in >> 3;
+      ring_put(&q, p);
+      ref[in % TEST_SIZE] = in;
+      in++;
+      count++;
+    } else {
+      if (ring_empty(&q)) {
+        CHECK(count == 0);
+        continue;
+      }
+      p = ring_front(&q);
+      CHECK((p.r == ref[out % TEST_SIZE]) && (p.l == (unsigned short)(out >> 3)));
+      ring_pop(&q);
+      out++;
+      count--;
+    }
+    CHECK(ring_count(&q) == count);
+  }
+}
+
+static void test_wrap(void)
+     /* ring_wrap(): ad.c のように負の添字やレジスタから求めた位置に使う */
+{
+  CHECK(ring_wrap(16, -1) == 15);
+  CHECK(ring_wrap(16, -16) == 0);
+  CHECK(ring_wrap(16, 17) == 1);
+  CHECK(ring_wrap(4, 16 - 1 - 5) == 2);
+}
+
+int main(void)
+{
+  test_window(0);
+  test_window(0xfffc);       /* 書いている途中で head が 0 に戻る */
+  test_queue(0);
+  test_queue(0xfffa);
+  test_wrap();
+  printf("ring.h: %d checks, %d failed\n", checks, fails);
+  return fails ? 1 : 0;
+}
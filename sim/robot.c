@@ -0,0 +1,206 @@
+#include <math.h>
+#include "robot.h"
+
+/* ライントレースロボットとコースの物理モデル                      */
+/*   コースは長円形で, s=0 は下側の直線の左端, 反時計回りに進む    */
+/*   ロボットは左右の車輪を独立に駆動する対向2輪型とする           */
+/*   モータは一次遅れで速度が変化するものとして扱う                */
+
+void track_default(struct track *t)
+     /* 標準のコース形状を設定する関数 */
+{
+  t->straight = 1.0;
+  t->radius = 0.3;
+  t->line_width = 0.019;
+  t->gap_start = 0.0;
+  t->gap_length = 0.0;
+}
+
+double track_length(const struct track *t)
+     /* コース1周の長さを返す関数 */
+{
+  return 2.0 * t->straight + 2.0 * M_PI * t->radius;
+}
+
+void track_locate(const struct track *t, double x, double y,
+                  double *s, double *offset)
+     /* 点(x,y)に最も近いライン上の点を求める関数                 */
+     /*   s : その点のコース上の位置, offset : 横ずれ(進行方向左が正) */
+{
+  double half = t->straight / 2.0;
+  double r = t->radius;
+  double dx, phi, d;
+
+  if ((x >= -half) && (x <= half)) {
+    if (y < 0) {                /* 下側の直線(+x 方向に進む) */
+      *s = x + half;
+      *offset = y + r;
+    } else {                    /* 上側の直線(-x 方向に進む) */
+      *s = t->straight + M_PI * r + (half - x);
+      *offset = r - y;
+    }
+  } else if (x > half) {        /* 右側の半円 */
+    dx = x - half;
+    phi = atan2(y, dx);         /* -π/2 → π/2 の向きに進む */
+    d = sqrt(dx * dx + y * y);
+    *s = t->straight + (phi + M_PI / 2.0) * r;
+    *offset = r - d;
+  } else {                      /* 左側の半円 */
+    dx = x + half;
+    phi = atan2(y, dx);         /* π/2 → 3π/2 の向きに進む */
+    if (phi < 0) phi += 2.0 * M_PI;
+    d = sqrt(dx * dx + y * y);
+    *s = 2.0 * t->straight + M_PI * r + (phi - M_PI / 2.0) * r;
+    *offset = r - d;
+  }
+}
+
+void robot_param_default(struct robot_param *p)
+     /* 標準のロボットのパラメータを設定する関数                   */
+     /* センサは AN1 と AN2 の2個で, ラインを挟むように配置する     */
+     /* control_proc() は sensor_l(AN1) が黒のとき右車輪を減速する   */
+     /* ので, AN1 のセンサはロボットの右側, AN2 は左側に置いている   */
+{
+  int ch;
+
+  p->tread = 0.12;
+  p->vmax = 0.4;
+  p->tau_drive = 0.05;
+  p->tau_coast = 0.3;
+  p->tau_brake = 0.02;
+  p->sensor_x = 0.08;
+  for (ch = 0; ch < ROBOT_ADCHNUM; ch++) {
+    p->sensor_y[ch] = 0.0;
+    p->sensor_used[ch] = 0;
+  }
+  p->sensor_y[1] = -0.015; p->sensor_used[1] = 1;
+  p->sensor_y[2] =  0.015; p->sensor_used[2] = 1;
+  p->sensor_radius = 0.004;
+  p->ad_white = 0x2b8;          /* 上位8ビットで 0xae (sensor_l/r で 0x57) */
+  p->ad_black = 0x360;          /* 上位8ビットで 0xd8 (sensor_l/r で 0x6c) */
+  p->ad_noise = 8;
+}
+
+void robot_init(struct robot *r, const struct track *t,
+                const struct robot_param *p, unsigned long seed)
+     /* ロボットをスタート位置に置く関数           */
+     /* s=0 の線の真上に, 進行方向を向けて静止させる */
+{
+  r->track = *t;
+  r->param = *p;
+  r->x = -t->straight / 2.0;
+  r->y = -t->radius;
+  r->th = 0.0;
+  r->vl = r->vr = 0.0;
+  r->s = 0.0;
+  r->offset = 0.0;
+  r->progress = 0.0;
+  r->noise_seed = seed ? seed : 1;
+}
+
+static int robot_noise(struct robot *r)
+     /* -ad_noise 〜 +ad_noise の一様ノイズを返す関数 (xorshift) */
+{
+  unsigned long x = r->noise_seed;
+
+  if (r->param.ad_noise <= 0) return 0;
+  x ^= x << 13; x &= 0xffffffffUL;
+  x ^= x >> 17;
+  x ^= x << 5;  x &= 0xffffffffUL;
+  r->noise_seed = x;
+  return (int)(x % (2 * r->param.ad_noise + 1)) - r->param.ad_noise;
+}
+
+int robot_sense(struct robot *r, int ch)
+     /* 指定チャネルのセンサの A/D 値(10ビット)を返す関数         */
+     /* 検出スポットと黒線の重なりの割合で白と黒の値を補間する     */
+     /* センサが接続されていないチャネルは 0 を返す                */
+{
+  const struct robot_param *p = &r->param;
+  const struct track *t = &r->track;
+  double sx, sy, s, off, lo, hi, cover, len;
+  int v;
+
+  if ((ch < 0) || (ch >= ROBOT_ADCHNUM) || !p->sensor_used[ch]) return 0;
+  sx = r->x + p->sensor_x * cos(r->th) - p->sensor_y[ch] * sin(r->th);
+  sy = r->y + p->sensor_x * sin(r->th) + p->sensor_y[ch] * cos(r->th);
+  track_locate(t, sx, sy, &s, &off);
+
+  cover = 0.0;
+  if ((t->gap_length <= 0.0) ||
+      (s < t->gap_start) || (s >= t->gap_start + t->gap_length)) {
+    lo = off - p->sensor_radius;
+    hi = off + p->sensor_radius;
+    if (lo < -t->line_width / 2.0) lo = -t->line_width / 2.0;
+    if (hi >  t->line_width / 2.0) hi =  t->line_width / 2.0;
+    len = hi - lo;
+    if (len > 0.0) cover = len / (2.0 * p->sensor_radius);
+  }
+  v = p->ad_white + (int)((p->ad_black - p->ad_white) * cover)
+    + robot_noise(r);
+  if (v < 0) v = 0;
+  if (v > 0x3ff) v = 0x3ff;
+  return v;
+}
+
+static double robot_wheel(const struct robot_param *p, double v, int drive,
+                          double dt)
+     /* 1つの車輪の速度を dt 秒だけ進める関数 (一次遅れ) */
+{
+  double target, tau;
+
+  switch (drive) {
+  case ROBOT_FORWARD: target =  p->vmax; tau = p->tau_drive; break;
+  case ROBOT_REVERSE: target = -p->vmax; tau = p->tau_drive; break;
+  case ROBOT_BRAKE:   target = 0.0;      tau = p->tau_brake; break;
+  default:            target = 0.0;      tau = p->tau_coast; break;
+  }
+  return target + (v - target) * exp(-dt / tau);
+}
+
+void robot_step(struct robot *r, int drive_l, int drive_r, double dt)
+     /* 左右の駆動状態で dt 秒だけロボットを動かす関数         */
+     /* 移動後にコース上の位置, 横ずれ, 累積走行距離を更新する */
+{
+  double v, w, s_old, ds, len;
+
+  r->vl = robot_wheel(&r->param, r->vl, drive_l, dt);
+  r->vr = robot_wheel(&r->param, r->vr, drive_r, dt);
+  v = (r->vl + r->vr) / 2.0;
+  w = (r->vr - r->vl) / r->param.tread;
+  r->x += v * cos(r->th + w * dt / 2.0) * dt;
+  r->y += v * sin(r->th + w * dt / 2.0) * dt;
+  r->th += w * dt;
+
+  s_old = r->s;
+  track_locate(&r->track, r->x, r->y, &r->s, &r->offset);
+  /* 1周の境目をまたいだときは道のりを補正する */
+  len = track_length(&r->track);
+  ds = r->s - s_old;
+  if (ds >  len / 2.0) ds -= len;
+  if (ds < -len / 2.0) ds += len;
+  r->progress += ds;
+}
+
+void robot_step_duty(struct robot *r, double duty_l, double duty_r, double dt)
+     /* 左右のデューティで dt 秒だけロボットを動かす関数              */
+     /*   duty : 正は正転, 負は逆転の時間の割合(-1〜1), 残りは惰性    */
+     /* PWM の周期はモータの時定数より十分短いので, dt の間に左右とも */
+     /* 同時にオンになり, デューティの小さい方から先にオフになるとして */
+     /* 区間ごとに robot_step() で進める                             */
+{
+  double al = fabs(duty_l), ar = fabs(duty_r), t0, t1;
+  int dl = duty_l > 0 ? ROBOT_FORWARD : ROBOT_REVERSE;
+  int dr = duty_r > 0 ? ROBOT_FORWARD : ROBOT_REVERSE;
+
+  if (al > 1.0) al = 1.0;
+  if (ar > 1.0) ar = 1.0;
+  t0 = (al < ar ? al : ar) * dt;            /* 両方オン */
+  t1 = (al < ar ? ar : al) * dt - t0;       /* 片方だけオン */
+  if (t0 > 0.0) robot_step(r, dl, dr, t0);
+  if (t1 > 0.0) {
+    if (al > ar) robot_step(r, dl, ROBOT_COAST, t1);
+    else robot_step(r, ROBOT_COAST, dr, t1);
+  }
+  if (dt - t0 - t1 > 0.0) robot_step(r, ROBOT_COAST, ROBOT_COAST, dt - t0 - t1);
+}
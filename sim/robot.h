@@ -0,0 +1,70 @@
+/* sim/robot.h */
+/* ライントレースロボットとコースの物理モデル (シミュレータ用) */
+/*   make sim (sim/sim.c) から使用する                         */
+/*   単位は長さ[m], 時間[s], 角度[rad]                         */
+
+/* 左右の車輪の駆動状態(モータドライバの入力 IN1,IN2 の組み合わせ) */
+#define ROBOT_COAST    0   /* IN1=0, IN2=0 : 惰性 */
+#define ROBOT_FORWARD  1   /* IN1=1, IN2=0 : 正転 */
+#define ROBOT_REVERSE  2   /* IN1=0, IN2=1 : 逆転 */
+#define ROBOT_BRAKE    3   /* IN1=1, IN2=1 : ブレーキ */
+
+/* センサの数(A/D変換器のチャネル数 AN0-AN7) */
+#define ROBOT_ADCHNUM  8
+
+/* コース(長円形 : 直線2本と半円2つ)の形状 */
+struct track {
+  double straight;      /* 直線部の長さ */
+  double radius;        /* 半円部の半径(ラインの中心) */
+  double line_width;    /* 黒線の幅 */
+  double gap_start;     /* 線が途切れている区間の開始位置(コース上の距離) */
+  double gap_length;    /* 線が途切れている区間の長さ(0 なら途切れなし) */
+};
+
+/* ロボットの機構とセンサのパラメータ */
+struct robot_param {
+  double tread;         /* 左右の車輪の間隔 */
+  double vmax;          /* デューティ100%の定常速度 */
+  double tau_drive;     /* 駆動時の速度応答の時定数 */
+  double tau_coast;     /* 惰性走行時の減速の時定数 */
+  double tau_brake;     /* ブレーキ時の減速の時定数 */
+  double sensor_x;      /* センサの車軸からの前方距離 */
+  double sensor_y[ROBOT_ADCHNUM]; /* 各チャネルのセンサの横位置(左が正) */
+  int sensor_used[ROBOT_ADCHNUM]; /* センサが接続されているチャネル */
+  double sensor_radius; /* センサの検出スポットの半径 */
+  int ad_white;         /* 白の上での A/D 値(10ビット) */
+  int ad_black;         /* 黒の上での A/D 値(10ビット) */
+  int ad_noise;         /* A/D 値に加える一様ノイズの振幅(10ビット) */
+};
+
+/* ロボットの状態 */
+struct robot {
+  struct track track;
+  struct robot_param param;
+  double x, y, th;      /* 位置と向き */
+  double vl, vr;        /* 左右の車輪の速度 */
+  double s;             /* コース上の位置(最も近いラインの点までの道のり) */
+  double offset;        /* ラインからの横ずれ(左が正) */
+  double progress;      /* スタートからの累積走行距離(コース上) */
+  unsigned long noise_seed; /* ノイズ生成用の乱数の状態 */
+};
+
+extern void track_default(struct track *t);
+     /* 標準のコース形状を設定する */
+extern double track_length(const struct track *t);
+     /* コース1周の長さを返す */
+extern void track_locate(const struct track *t, double x, double y,
+                         double *s, double *offset);
+     /* 点(x,y)に最も近いライン上の点のコース上の位置 s と横ずれ offset を求める */
+extern void robot_param_default(struct robot_param *p);
+     /* 標準のロボットのパラメータを設定する */
+extern void robot_init(struct robot *r, const struct track *t,
+                       const struct robot_param *p, unsigned long seed);
+     /* ロボットをスタート位置(コース上 s=0 の線上)に置く */
+extern int robot_sense(struct robot *r, int ch);
+     /* 指定チャネルのセンサの A/D 値(10ビット)を返す */
+extern void robot_step(struct robot *r, int drive_l, int drive_r, double dt);
+     /* 左右の駆動状態(ROBOT_COAST など)で dt 秒だけロボットを動かす */
+extern void robot_step_duty(struct robot *r, double duty_l, double duty_r,
+                            double dt);
+     /* 左右のデューティ(正:正転, 負:逆転, 残りは惰性)で dt 秒だけ動かす */
@@ -0,0 +1,452 @@
+/*   ライントレーサ制御プログラムのホスト上シミュレータ (make sim)       */
+/*   linetracer.c, ad.c, timer.c, key.c, lcd.c を変更せずにホストの   */
+/*   gcc でコンパイルし, I/O レジスタを h8sim_io[] に置き換えて動かす */
+/*   ITU0 のコンペアマッチを模擬して int_imia0() を呼び出し, A/D変換 */
+/*   の結果を DMAC と同じように ad_dmabuf に転送し, ポートB(PB0-3 は */
+/*   8ビットタイマの PWM 出力)                                       */
+/*   で sim/robot.c のロボットを走らせる(閉ループ)                   */
+/*   使い方は linetracer-sim -h を参照                                 */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <ucontext.h>
+#include "h8-3069-iodef.h"
+#include "ad.h"
+#include "pid.h"
+#include "motor.h"
+#include "robot.h"
+
+/* 基板上のモータドライバの接続(ポートBのビット番号) */
+#define LMOTOR_IN1   0
+#define LMOTOR_IN2   1
+#define RMOTOR_IN1   2
+#define RMOTOR_IN2   3
+
+/* CPUクロック[Hz] */
+#define PHI 25000000.0
+
+/* linetracer.c の状態番号 (STATE_LINETRACE) */
+#define SIM_STATE_LINETRACE 1
+
+/* センサのしきい値の初期値 (linetracer.c の sensor_limit_1, _2) */
+#define SIM_LIMIT_BLACK 0x360
+#define SIM_LIMIT_WHITE 0x2b8
+
+/* 横ずれがこれを越えたらコースアウトとしてシミュレーションを終える[m] */
+#define SIM_OFFTRACK 0.15
+
+/* I/O レジスタの実体 */
+volatile unsigned char h8sim_io[0x10000];
+
+/* ファームウェア側の関数と変数 */
+extern int linetracer_main(void);
+extern void int_imia0(void);
+extern volatile unsigned char global_state;
+extern volatile short sensor_limit;
+extern volatile unsigned char kp;
+extern volatile unsigned char jumpmode;
+extern volatile unsigned char steermode;
+extern struct pid steer_pid;
+extern struct motor_cmd motor_now;
+
+/* main() の初期化部分を実行するためのコンテキスト */
+static ucontext_t sim_ctx, fw_ctx;
+static char fw_stack[256 * 1024];
+static int fw_booted = 0;  /* main() が最初に ENINT() に到達した */
+static int in_isr = 0;     /* 割り込みハンドラを実行中 */
+static int int_mask = 1;   /* CCR の I ビット */
+
+void h8sim_enint(void)
+     /* ENINT() の代わり                                       */
+     /* main() が初めて割り込みを許可した時点で初期化完了とみなし, */
+     /* 以降はシミュレータ側に制御を戻す(メインループは実行しない) */
+{
+  int_mask = 0;
+  if (!in_isr && !fw_booted) {
+    fw_booted = 1;
+    swapcontext(&fw_ctx, &sim_ctx);
+  }
+}
+
+void h8sim_disint(void)
+     /* DISINT() の代わり */
+{
+  int_mask = 1;
+}
+
+unsigned char h8sim_intlock(void)
+     /* INTR_LOCK(), INTR_LOCK0() の代わり (元のマスクを返す) */
+{
+  unsigned char s = int_mask;
+
+  int_mask = 1;
+  return s;
+}
+
+void h8sim_intunlock(unsigned char s)
+     /* INTR_UNLOCK() の代わり */
+{
+  int_mask = s;
+}
+
+static void fw_entry(void)
+{
+  linetracer_main();
+}
+
+static void fw_boot(void)
+     /* ファームウェアの main() を ENINT() まで実行する関数 */
+{
+  getcontext(&fw_ctx);
+  fw_ctx.uc_stack.ss_sp = fw_stack;
+  fw_ctx.uc_stack.ss_size = sizeof(fw_stack);
+  fw_ctx.uc_link = &sim_ctx;
+  makecontext(&fw_ctx, fw_entry, 0);
+  swapcontext(&sim_ctx, &fw_ctx);
+}
+
+static void sim_isr(void (*handler)(void))
+     /* 割り込みハンドラを呼び出す関数                       */
+     /* 受付時に I ビットがセットされ, RTE で元に戻るのを模擬 */
+{
+  int mask = int_mask;
+
+  in_isr = 1;
+  int_mask = 1;
+  handler();
+  int_mask = mask;
+  in_isr = 0;
+}
+
+static double itu0_period(void)
+     /* timer_set() が設定した ITU0 の割り込み周期[s]を返す関数 */
+     /* GRA0 のコンペアマッチでカウンタがクリアされる           */
+{
+  unsigned int gra;
+  int tpsc;
+
+  gra = (GRA0H << 8) | GRA0L;
+  tpsc = T16TCR0 & 0x07;
+  if (tpsc > 3) tpsc = 3;        /* 外部クロックは使わない */
+  return (double)(gra + 1) * (1 << tpsc) / PHI;
+}
+
+static volatile unsigned char *dma_host_addr(unsigned long mar)
+     /* DMAC の転送先アドレス(24ビット)をホストのアドレスに戻す関数  */
+     /* ad.c は ad_dmabuf のアドレスの下位24ビットを MAR に書くので, */
+     /* 上位のビットは ad_dmabuf のアドレスから補う                  */
+{
+  uintptr_t base = (uintptr_t)ad_dmabuf;
+  uintptr_t a = (base & ~(uintptr_t)0xffffff) | mar;
+
+  if (a + 0x800000 < base) a += 0x1000000;      /* 16MB の境界をまたいだ */
+  else if (a > base + 0x800000) a -= 0x1000000;
+  return (volatile unsigned char *)a;
+}
+
+static void dma_adi(void)
+     /* A/D変換終了(ADI)で起動される DMAC のショートアドレスモードの */
+     /* 転送を模擬する関数 (I/O -> メモリ, リピートモード)             */
+     /* 起動されたチャネルがあれば ADF は DMAC がクリアする           */
+{
+  static volatile unsigned char *reg[4] = { &MAR0AR, &MAR0BR, &MAR1AR, &MAR1BR };
+  volatile unsigned char *d;
+  unsigned long mar;
+  int n, step, act = 0;
+
+  for (n = 0; n < 4; n++) {
+    d = reg[n];
+    if ((d[7] & 0x87) != 0x83) continue;   /* DTE=1, DTS=ADI */
+    mar = ((unsigned long)d[1] << 16) | (d[2] << 8) | d[3];
+    if (d[7] & 0x40) {                     /* ワード転送 */
+      *(volatile unsigned short *)dma_host_addr(mar) =
+        (H8SIM_IOREG(0xffff00 | d[6]) << 8) | H8SIM_IOREG(0xffff01 | d[6]);
+      step = 2;
+    } else {
+      *dma_host_addr(mar) = H8SIM_IOREG(0xffff00 | d[6]);
+      step = 1;
+    }
+    if (d[7] & 0x20) step = -step;         /* DTID */
+    mar += step;
+    if (--d[4] == 0) {                     /* ETCRH */
+      if (d[7] & 0x10) {                   /* リピートモード */
+        d[4] = d[5];
+        mar -= step * (d[5] ? d[5] : 256);
+      } else {
+        d[7] &= ~0x80;                     /* 転送終了 */
+      }
+    }
+    d[1] = mar >> 16; d[2] = mar >> 8; d[3] = mar;
+    act = 1;
+  }
+  if (act) ADCSR &= ~0x80;
+}
+
+static void ad_convert(struct robot *r)
+     /* A/D変換器を模擬する関数                                 */
+     /* ADST がセットされていれば変換結果を ADDRA-D に格納して  */
+     /* ADF をセットし, ADIE が 1 なら DMAC の転送を行う        */
+     /* 変換時間(最大 4ch x 134ステート)は割り込み周期に比べて  */
+     /* 十分短いので, 同じ割り込み周期の中で終わるものとする    */
+{
+  volatile unsigned char *addr[4] = { &ADDRAH, &ADDRBH, &ADDRCH, &ADDRDH };
+  unsigned char csr = ADCSR;
+  int ch, first, last, v;
+
+  if (((csr & 0x20) == 0) && (ADCR & 0x80) && (T8TCSR0 & 0x10))
+    csr |= 0x20;                      /* 8ビットタイマ ch0 のコンペアマッチで開始 */
+  if ((csr & 0x20) == 0) return;      /* ADST = 0 : 変換停止中 */
+  if (csr & 0x10) {                   /* スキャンモード */
+    first = csr & 0x04;
+    last = csr & 0x07;
+  } else {                            /* 単一モード */
+    first = last = csr & 0x07;
+  }
+  for (ch = first; ch <= last; ch++) {
+    v = robot_sense(r, ch);
+    addr[ch & 3][0] = (v >> 2) & 0xff;  /* ADDRxH */
+    addr[ch & 3][1] = (v << 6) & 0xc0;  /* ADDRxL */
+  }
+  csr |= 0x80;                        /* ADF */
+  if ((csr & 0x10) == 0) csr &= ~0x20; /* 単一モードは1回で停止 */
+  ADCSR = csr;
+  if (csr & 0x40) dma_adi();
+}
+
+static double pin_duty(int bit)
+     /* ポートBの端子の出力の平均値(0-1)を返す関数                      */
+     /* PB0-3 は8ビットタイマ ch0-3 の出力が選ばれていれば(TCSR の OS が */
+     /* 0 でなければ) TCORA で 1, TCORB で 0 になる PWM のデューティ     */
+{
+  static volatile unsigned char *tcr[4] = { &T8TCR0, &T8TCR1, &T8TCR2, &T8TCR3 };
+  static volatile unsigned char *tcsr[4] = { &T8TCSR0, &T8TCSR1, &T8TCSR2, &T8TCSR3 };
+  static volatile unsigned char *tcora[4] = { &TCORA0, &TCORA1, &TCORA2, &TCORA3 };
+  static volatile unsigned char *tcorb[4] = { &TCORB0, &TCORB1, &TCORB2, &TCORB3 };
+  unsigned char os;
+
+  if ((bit < 4) && ((os = *tcsr[bit] & 0x0f) != 0)) {
+    if ((*tcr[bit] & 0x07) == 0) return 0.0;      /* カウント停止中 */
+    switch (os) {
+    case 0x0a: return 1.0;                        /* 常に 1 */
+    case 0x06:                                    /* PWM */
+      if (*tcorb[bit] >= *tcora[bit]) return 1.0;
+      return (*tcorb[bit] + 1.0) / (*tcora[bit] + 1.0);
+    default:   return 0.0;
+    }
+  }
+  return ((PBDDR & PBDR) >> bit) & 1;
+}
+
+static double motor_duty(int in1, int in2)
+     /* 1つのモータのデューティ(正:正転, 負:逆転)を求める関数 */
+     /* IN1=IN2=1 のブレーキは使わないので惰性として扱う       */
+{
+  return pin_duty(in1) - pin_duty(in2);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  -t sec    シミュレーションする時間[s] (60)\n"
+    "  -n laps   指定周回数を走ったら終了 (0:時間まで)\n"
+    "  -k kp     kp の値 (8)\n"
+    "  -j mode   jumpmode 0:JUMP 1:TURNRIGHT 2:TURNLEFT (0)\n"
+    "  -m mode   steermode 0:BANGBANG 1:PID (0)\n"
+    "  -P p,i,d  STEER_PID のゲイン (x8, 既定はファームウェアの値)\n"
+    "  -L limit  sensor_limit (白黒のしきい値, 既定は 0x%03x)\n"
+    "  -N noise  A/D 値のノイズ振幅[LSB, 10ビット] (8)\n"
+    "  -v vmax   デューティ100%%の速度[m/s] (0.4)\n"
+    "  -g s,len  s[m]の位置から len[m]だけ線を途切れさせる\n"
+    "  -S seed   ノイズの乱数の種 (1)\n"
+    "  -o file   トレースを CSV で出力\n"
+    "  -i ticks  トレースの出力間隔[割り込み回数] (10)\n"
+    "  -q        周回ごとの表示をしない\n",
+    prog, (SIM_LIMIT_BLACK + SIM_LIMIT_WHITE) / 2);
+}
+
+int main(int argc, char **argv)
+{
+  struct track track;
+  struct robot_param param;
+  struct robot robot;
+  double sim_time = 60.0, dt, t, len, max_offset, lap_start, best_lap;
+  double wall;
+  int laps_limit = 0, opt_kp = 8, opt_jump = 0, quiet = 0, interval = 10;
+  int opt_steer = 0, opt_pid = 0, pid_p = 0, pid_i = 0, pid_d = 0;
+  int limit = (SIM_LIMIT_BLACK + SIM_LIMIT_WHITE) / 2;
+  unsigned long seed = 1;
+  const char *trace_name = NULL;
+  FILE *trace = NULL;
+  unsigned long tick, ticks;
+  int laps, lost, lost_count, offtrack, n;
+  double dl, dr, duty_l, duty_r, duty_sum_l, duty_sum_r;
+  struct timespec ts0, ts1;
+  int c;
+
+  track_default(&track);
+  robot_param_default(&param);
+
+  while ((c = getopt(argc, argv, "t:n:k:j:m:P:L:N:v:g:S:o:i:qh")) != -1) {
+    switch (c) {
+    case 't': sim_time = atof(optarg); break;
+    case 'n': laps_limit = atoi(optarg); break;
+    case 'k': opt_kp = atoi(optarg); break;
+    case 'j': opt_jump = atoi(optarg); break;
+    case 'm': opt_steer = atoi(optarg); break;
+    case 'P':
+      if (sscanf(optarg, "%d,%d,%d", &pid_p, &pid_i, &pid_d) != 3) {
+        usage(argv[0]);
+        return 1;
+      }
+      opt_pid = 1;
+      break;
+    case 'L': limit = (int)strtol(optarg, NULL, 0); break;
+    case 'N': param.ad_noise = atoi(optarg); break;
+    case 'v': param.vmax = atof(optarg); break;
+    case 'g':
+      if (sscanf(optarg, "%lf,%lf", &track.gap_start, &track.gap_length) != 2) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'S': seed = strtoul(optarg, NULL, 0); break;
+    case 'o': trace_name = optarg; break;
+    case 'i': interval = atoi(optarg); if (interval < 1) interval = 1; break;
+    case 'q': quiet = 1; break;
+    default:  usage(argv[0]); return 1;
+    }
+  }
+
+  if (trace_name != NULL) {
+    trace = fopen(trace_name, "w");
+    if (trace == NULL) {
+      perror(trace_name);
+      return 1;
+    }
+    fprintf(trace, "t,x,y,th,s,offset,an1,an2,"
+            "motorspeed_l,motorspeed_r,duty_l,duty_r\n");
+  }
+
+  robot_init(&robot, &track, &param, seed);
+
+  /* 初期化(キーは押されていない状態) */
+  P6DR = 0x03;
+  fw_boot();
+  if (!fw_booted) {
+    fprintf(stderr, "main() が割り込みを許可せずに終了した\n");
+    return 1;
+  }
+  if (((TSTR & 0x01) == 0) || ((TISRA & 0x10) == 0)) {
+    fprintf(stderr, "ITU0 の割り込みが設定されていない\n");
+    return 1;
+  }
+  dt = itu0_period();
+
+  /* メニューで設定する値をオプションで与えて走行開始 */
+  kp = opt_kp;
+  jumpmode = opt_jump;
+  steermode = opt_steer;
+  if (opt_pid) {
+    steer_pid.kp = pid_p;
+    steer_pid.ki = pid_i;
+    steer_pid.kd = pid_d;
+  }
+  sensor_limit = limit;
+  global_state = SIM_STATE_LINETRACE;
+
+  len = track_length(&track);
+  ticks = (unsigned long)(sim_time / dt);
+  laps = lost = lost_count = offtrack = 0;
+  max_offset = lap_start = 0.0;
+  best_lap = 0.0;
+  duty_l = duty_r = duty_sum_l = duty_sum_r = 0;
+  n = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts0);
+  for (tick = 0; tick < ticks; tick++) {
+    t = tick * dt;
+
+    /* ITU0 のコンペアマッチ (IMFA0 をセットして割り込み) */
+    TISRA |= 0x01;
+    if (!int_mask) sim_isr(int_imia0);
+    ad_convert(&robot);
+
+    /* ポートBの出力で1周期分ロボットを動かす */
+    dl = motor_duty(LMOTOR_IN1, LMOTOR_IN2);
+    dr = motor_duty(RMOTOR_IN1, RMOTOR_IN2);
+    robot_step_duty(&robot, dl, dr, dt);
+    duty_l += dl;
+    duty_r += dr;
+    duty_sum_l += dl;
+    duty_sum_r += dr;
+
+    /* 両方のセンサがラインから外れたらライン喪失 */
+    if (fabs(robot.offset) > fabs(param.sensor_y[1]) + param.sensor_radius
+                             + track.line_width / 2.0) {
+      if (!lost) lost_count++;
+      lost = 1;
+    } else {
+      lost = 0;
+    }
+    if (fabs(robot.offset) > max_offset) max_offset = fabs(robot.offset);
+    if (fabs(robot.offset) > SIM_OFFTRACK) {
+      offtrack = 1;
+      break;
+    }
+
+    if (robot.progress >= (laps + 1) * len) {
+      laps++;
+      if (!quiet)
+        printf("lap %d: %.3f s\n", laps, t + dt - lap_start);
+      if ((best_lap == 0.0) || (t + dt - lap_start < best_lap))
+        best_lap = t + dt - lap_start;
+      lap_start = t + dt;
+      if ((laps_limit > 0) && (laps >= laps_limit)) {
+        tick++;
+        break;
+      }
+    }
+
+    if (trace != NULL) {
+      n++;
+      if (n >= interval) {
+        fprintf(trace, "%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%d,%d,%d,%d,%.3f,%.3f\n",
+                t + dt, robot.x, robot.y, robot.th, robot.s,
+                robot.offset * 1000.0,
+                robot_sense(&robot, 1), robot_sense(&robot, 2),
+                motor_now.speed[MOTOR_L], motor_now.speed[MOTOR_R],
+                duty_l / n, duty_r / n);
+        n = 0;
+        duty_l = duty_r = 0;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts1);
+  wall = (ts1.tv_sec - ts0.tv_sec) + (ts1.tv_nsec - ts0.tv_nsec) / 1e9;
+
+  if (trace != NULL) fclose(trace);
+
+  printf("ticks         : %lu (%.3f s, period %.1f us)\n",
+         tick, tick * dt, dt * 1e6);
+  printf("laps          : %d", laps);
+  if (best_lap > 0.0) printf(" (best %.3f s)", best_lap);
+  printf("\n");
+  printf("distance      : %.3f m\n", robot.progress);
+  printf("line lost     : %d\n", lost_count);
+  printf("max offset    : %.1f mm%s\n", max_offset * 1000.0,
+         offtrack ? " (off track)" : "");
+  if (tick > 0)
+    printf("mean duty L/R : %.3f / %.3f\n",
+           duty_sum_l / tick, duty_sum_r / tick);
+  printf("speed         : %.2f Mticks/s (%.0fx real time)\n",
+         wall > 0 ? tick / wall / 1e6 : 0.0,
+         wall > 0 ? tick * dt / wall : 0.0);
+  return offtrack ? 2 : 0;
+}
@@ -1,4 +1,5 @@
 #include "h8-3069-iodef.h"
+#include "fastram.h"
 
 /* 内部クロックφのときの1usあたりのGRA値 */
 #define TCONST1us 25
@@ -11,7 +12,8 @@ int timer_set(int ch, unsigned int time_us);
 void timer_start(int ch);
 void timer_stop(int ch);
 void timer_init(void);
-void timer_intflag_reset(int ch);
+void timer_intflag_reset(int ch) FASTCODE;
+void timer_freerun(int ch);
 
 int timer_set(int ch, unsigned int time_us)
      /* 指定チャネルのタイマを指定時間間隔で割り込み設定する関数 */
@@ -131,3 +133,43 @@ void timer_intflag_reset(int ch)
   chmask = ~(chmask << ch);
   TISRA = TISRA & chmask; /* 指定したチャネルだけフラグをリセット */
 }
+
+void timer_freerun(int ch)
+     /* 指定チャネルのタイマをフリーランカウンタとして動かす関数   */
+     /* 内部クロックφでカウントし, クリアも割り込みも行わない    */
+     /* 16CNT を読むと φ=25MHz で 40ns 単位の時刻が得られる       */
+     /* (2621.44us で一周するので, それより短い時間の計測に使う)  */
+     /* 指定チャネルの範囲 ch: 0-2                                */
+{
+  volatile unsigned char *tcr_addr,*tior_addr,*tcnth_addr,*tcntl_addr;
+  unsigned char chmask;
+
+  switch (ch){
+  case 1:
+    tcr_addr   = &T16TCR1;   tior_addr  = &TIOR1;
+    tcnth_addr = &T16TCNT1H; tcntl_addr = &T16TCNT1L;
+    break;
+  case 2:
+    tcr_addr   = &T16TCR2;   tior_addr  = &TIOR2;
+    tcnth_addr = &T16TCNT2H; tcntl_addr = &T16TCNT2L;
+    break;
+  case 0:
+  default:
+    ch = 0;
+    tcr_addr   = &T16TCR0;   tior_addr  = &TIOR0;
+    tcnth_addr = &T16TCNT0H; tcntl_addr = &T16TCNT0L;
+    break;
+  }
+  chmask = 1;
+  chmask = ~(chmask << ch);
+  TSTR = TSTR & chmask;
+  *tcr_addr = 0x80;         /* クリア禁止, 内部クロックφ */
+  *tior_addr = 0x88;        /* GRA, GRB のコンペアマッチ出力禁止 */
+  /* 指定チャネルだけ割り込み禁止, フラグクリア(他のチャネルは保存) */
+  TISRA = TISRA & ~(0x11 << ch);
+  TISRB = TISRB & ~(0x11 << ch);
+  TISRC = TISRC & ~(0x11 << ch);
+  *tcnth_addr = 0;
+  *tcntl_addr = 0;
+  TSTR = TSTR | ~chmask;
+}
@@ -17,3 +17,7 @@ extern void timer_intflag_reset(int ch);
      /* 指定チャネルの範囲 ch: 0-4                                 */
      /* 割り込みハンドラ内の割り込みを許可する前に必ず呼び出すこと */
 
+extern void timer_freerun(int ch);
+     /* 指定チャネルのタイマをフリーランカウンタとして動かす */
+     /* φ(40ns)単位でカウントし, 割り込みは発生しない        */
+     /* ch: 0-2                                              */
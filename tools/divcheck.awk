@@ -0,0 +1,116 @@
+# 割り込み処理から呼ばれる関数に除算がないかを調べるスクリプト
+#   objdump -d の出力を読み, roots の関数から jsr/bsr でたどれる関数の
+#   中に除算命令(divxu, divxs)か libgcc の除算関数の呼び出しがあれば,
+#   呼び出しの経路を表示して終了コード 1 で終わる
+#
+# 使い方 (make divcheck から呼ばれる)
+#   h8300-hms-objdump -d linetracer.coff |
+#     awk -v roots="_int_imia0 _ad_read" -f tools/divcheck.awk
+#   roots  : 調べ始める関数 (空白区切り)
+#            関数ポインタ(sensor_update() の read など)の先はたどれない
+#            ので, その先の関数も roots に書くこと
+#   div    : 除算命令の正規表現 (既定は H8/300H の divxu, divxs)
+#   divfn  : 除算とみなす関数名の正規表現 (既定は libgcc の除算, 剰余)
+
+BEGIN {
+  if (div == "") div = "\tdivx[us]"
+  if (divfn == "") divfn = "^_*(u?(div|mod)[sdh]i3|u?divmod[sdh]i4)$"
+  nfunc = 0
+}
+
+# 関数の先頭  "00000100 <_int_imia0>:"
+/^[0-9a-f]+ <[^>]+>:$/ {
+  cur = $2
+  gsub(/[<>:]/, "", cur)
+  addr[hexnorm($1)] = cur
+  func_name[nfunc++] = cur
+  next
+}
+
+cur == "" { next }
+
+# 除算命令
+$0 ~ div {
+  if (!(cur in divline)) divline[cur] = $0
+}
+
+# 関数の呼び出し (直接の呼び出しだけ, 先は END で関数名にする)
+/\t(jsr|bsr|call[lq]?)[ \t]/ {
+  if (match($0, /<[^>+]+>/)) {
+    callee = substr($0, RSTART + 1, RLENGTH - 2)
+  } else if (match($0, /@0x[0-9a-f]+/) || match($0, /@[0-9][0-9a-f]*/) ||
+             match($0, /\(0x[0-9a-f]+\)/)) {
+    callee = substr($0, RSTART, RLENGTH)
+    gsub(/[@()]/, "", callee)
+    callee = "@" hexnorm(callee)
+  } else {
+    indirect[cur] = 1
+    next
+  }
+  ncall[cur]++
+  calls[cur, ncall[cur]] = callee
+}
+
+END {
+  n = split(roots, r, /[ \t]+/)
+  head = 0
+  tail = 0
+  for (i = 1; i <= n; i++) {
+    if (r[i] == "") continue
+    if (!(r[i] in ncall) && !(r[i] in divline) && !found_root(r[i])) {
+      printf("divcheck: %s が見つからない\n", r[i])
+      bad = 1
+      continue
+    }
+    queue[tail++] = r[i]
+    seen[r[i]] = 1
+    from[r[i]] = ""
+  }
+  while (head < tail) {
+    f = queue[head++]
+    if (f ~ divfn || (f in divline)) {
+      printf("divcheck: 割り込み処理から除算に届く: %s\n", path(f))
+      if (f in divline) printf("    %s\n", divline[f])
+      bad = 1
+      continue
+    }
+    if (f in indirect) {
+      printf("divcheck: 注意: %s は関数ポインタで呼び出している (先は roots に書くこと)\n", f)
+    }
+    for (j = 1; j <= ncall[f]; j++) {
+      g = calls[f, j]
+      if (substr(g, 1, 1) == "@") {
+        a = substr(g, 2)
+        if (!(a in addr)) continue   # 関数の先頭でない(関数内の分岐)
+        g = addr[a]
+      }
+      if (g in seen) continue
+      seen[g] = 1
+      from[g] = f
+      queue[tail++] = g
+    }
+  }
+  if (!bad) printf("divcheck: OK (%d 個の関数に除算なし)\n", tail)
+  exit bad
+}
+
+function hexnorm(h) {
+  h = tolower(h)
+  sub(/^0x/, "", h)
+  sub(/^0+/, "", h)
+  return (h == "") ? "0" : h
+}
+
+function found_root(name,    i) {
+  for (i = 0; i < nfunc; i++) if (func_name[i] == name) return 1
+  return 0
+}
+
+function path(f,    p) {
+  p = f
+  while (from[f] != "") {
+    f = from[f]
+    p = f " -> " p
+  }
+  return p
+}
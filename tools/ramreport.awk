@@ -0,0 +1,47 @@
+# 内蔵RAMの使用量を表示するスクリプト
+#   size -Ax の出力を読み, アドレスが内蔵RAMの範囲にあるセクションの
+#   大きさを合計して, 使用量と残りを表示する
+#   内蔵RAMに置くセクション(.fast など)はリンカスクリプトで決まる
+#   (fastram.h 参照). スタックは含まないので, RAM_CAP=int や ROM化で
+#   内蔵RAMの最後をスタックにするときは, その分の余裕を残すこと
+#
+# 使い方 (make のリンクの後に呼ばれる)
+#   h8300-hms-size -Ax linetracer.coff | awk -f tools/ramreport.awk
+#   start : 内蔵RAMの先頭アドレス (既定は 0xffbf20)
+#   size  : 内蔵RAMの大きさ (既定は 0x4000)
+
+BEGIN {
+  if (start == "") start = "0xffbf20"
+  if (size == "") size = "0x4000"
+  lo = hex(start)
+  hi = lo + hex(size)
+  used = 0
+}
+
+# セクションの行  ".fast  0x5a4  0xffbf20"
+/^\.[^ \t]+[ \t]+0x[0-9a-fA-F]+[ \t]+0x[0-9a-fA-F]+/ {
+  a = hex($3)
+  n = hex($2)
+  if (n > 0 && a >= lo && a < hi) {
+    printf("ramreport: %-12s %6d バイト (0x%06x-0x%06x)\n", $1, n, a, a + n - 1)
+    used += n
+  }
+}
+
+END {
+  printf("ramreport: 内蔵RAM %d / %d バイト使用, 残り %d バイト (スタックを除く)\n",
+         used, hi - lo, hi - lo - used)
+  if (used > hi - lo) exit 1
+}
+
+function hex(h,    i, c, v) {
+  h = tolower(h)
+  sub(/^0x/, "", h)
+  v = 0
+  for (i = 1; i <= length(h); i++) {
+    c = index("0123456789abcdef", substr(h, i, 1))
+    if (c == 0) break
+    v = v * 16 + c - 1
+  }
+  return v
+}
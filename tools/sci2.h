@@ -1,3 +1,8 @@
+#define NOT_ECHO 0
+#define DO_ECHO 1
+#define NOTSENDCR 0
+#define SENDCR 1
+
 extern void init_sci2(void);
   /* SCI2を初期化する関数 */
   /*   引数：なし */
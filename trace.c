@@ -0,0 +1,122 @@
+#include "hist.h"
+#include "trace.h"
+#include "fastram.h"
+
+/* 両方白の多数決の窓[ms] (直前の窓の過半数が両方白なら「長いとき」の遷移) */
+#define TRACE_CROSSWIN 10    /* 横線とみなすのに要る直前の両方白 */
+/* 最小滞在時間[ms] (これより短い間は「短いとき」の遷移を使う) */
+#define TRACE_CROSSMIN 5     /* 横線を越え始めてから判定を変えない時間 */
+#define TRACE_TURNMIN  5     /* 旋回を始めてから判定を変えない時間 */
+/* 最大滞在時間[ms] (0 はなし, 越えたら timeout の状態へ) */
+#define TRACE_GAPMAX   200   /* 線の途切れを探す時間 */
+
+/* 遷移先に書くと jumpmode で行き先が決まる疑似状態 */
+#define TRACE_JUMP TRACE_NUM
+
+/* JUMPMODE_JUMP, JUMPMODE_TURNRIGHT, JUMPMODE_TURNLEFT のときの行き先 */
+static const unsigned char trace_jump[3] FASTCONST = {
+  TRACE_CROSSING, TRACE_TURN_RIGHT, TRACE_TURN_LEFT
+};
+
+#define TK TRACE_TRACKING
+#define EL TRACE_EDGE_LEFT
+#define ER TRACE_EDGE_RIGHT
+#define GP TRACE_GAP
+#define TL TRACE_TURN_LEFT
+#define TR TRACE_TURN_RIGHT
+#define CR TRACE_CROSSING
+#define JP TRACE_JUMP
+
+/* 状態表                                                              */
+/*   next[0][in] : 滞在時間が mindwell 未満のときの入力 in での遷移先    */
+/*   next[1][in] : 滞在時間が mindwell 以上のときの遷移先               */
+/*   window が 0 でない状態は, 滞在時間の代わりに直前の window 周期の   */
+/*   両方白の回数が過半数かどうかで next[0] と next[1] を選ぶ            */
+/*   入力の順は 両方白, 左(AN2)だけ黒, 右(AN1)だけ黒, 両方黒           */
+/* ・片側が黒のまま両方黒になったときは急カーブとみなし, 曲がり続ける */
+/* ・直前の TRACE_CROSSWIN の過半数が両方白での両方黒は横線で,        */
+/*   jumpmode に従う (TK だけでなく EL, ER からも. 元の whitecount>5) */
+/* ・横線を直進で越えた後の両方白は線の途切れで, TRACE_GAPMAX まで直進 */
+/* EDGE の減速に使う spent は滞在時間と別に数える (元の spent と同じ)  */
+/*   両方白で 0 に戻し, 片側だけ黒か, 両方黒で EL, ER に留まる周期に   */
+/*   1 増やす. EL と ER の間を行き来しても 0 には戻らない               */
+struct trace_def {
+  char name[3];
+  unsigned char cmd;
+  unsigned char window;
+  unsigned short mindwell, maxdwell;
+  unsigned char timeout;
+  unsigned char next[2][TRACE_IN_NUM];
+};
+
+static const struct trace_def trace_def[TRACE_NUM] FASTCONST = {
+  /* 名前  指令                 窓              min             max           timeout  短いとき          長いとき */
+  { "TK", TRACE_CMD_TRACK,    TRACE_CROSSWIN, 0,              0,            TK, {{TK, EL, ER, TK}, {TK, EL, ER, JP}} },
+  { "EL", TRACE_CMD_EDGE_L,   TRACE_CROSSWIN, 0,              0,            EL, {{TK, EL, ER, EL}, {TK, EL, ER, JP}} },
+  { "ER", TRACE_CMD_EDGE_R,   TRACE_CROSSWIN, 0,              0,            ER, {{TK, EL, ER, ER}, {TK, EL, ER, JP}} },
+  { "GP", TRACE_CMD_STRAIGHT, 0,              0,              TRACE_GAPMAX, TK, {{GP, EL, ER, JP}, {GP, EL, ER, JP}} },
+  { "TL", TRACE_CMD_SPIN_L,   0,              TRACE_TURNMIN,  0,            TL, {{TL, TL, TL, TL}, {TK, EL, ER, TL}} },
+  { "TR", TRACE_CMD_SPIN_R,   0,              TRACE_TURNMIN,  0,            TR, {{TR, TR, TR, TR}, {TK, EL, ER, TR}} },
+  { "CR", TRACE_CMD_STRAIGHT, 0,              TRACE_CROSSMIN, 0,            CR, {{CR, CR, CR, CR}, {GP, EL, ER, CR}} }
+};
+
+void trace_init(struct trace *t);
+int trace_update(struct trace *t, int in, int jumpmode) FASTCODE;
+int trace_cmd(int state) FASTCODE;
+const char *trace_name(int state);
+
+void trace_init(struct trace *t)
+     /* 状態機械の初期化関数 */
+{
+  t->state = TRACE_TRACKING;
+  t->dwell = 0;
+  t->spent = 0;
+  t->white = 0;
+}
+
+int trace_update(struct trace *t, int in, int jumpmode)
+     /* 1周期分の遷移を行う関数 (control_proc() から呼ばれる)       */
+     /* 状態表を引いて遷移先を決め, 状態が変わったら滞在時間を戻す */
+     /* 両方白の多数決は履歴のビット数えなので窓の長さによらない   */
+     /* spent は状態表の注の規則で数える                           */
+{
+  const struct trace_def *d = &trace_def[t->state];
+  int next, row;
+
+  in &= TRACE_IN_NUM - 1;
+  hist_push(t->white, in == 0);
+  if (d->window != 0) row = hist_count(t->white, d->window) > (d->window >> 1);
+  else row = t->dwell >= d->mindwell;
+
+  if (d->maxdwell != 0 && t->dwell >= d->maxdwell) {
+    next = d->timeout;
+  } else {
+    next = d->next[row][in];
+    if (next == TRACE_JUMP) {
+      next = trace_jump[(jumpmode >= 0 && jumpmode < 3) ? jumpmode : 0];
+    }
+  }
+  if (next != t->state) {
+    t->state = next;
+    t->dwell = 0;
+  }
+  if (t->dwell != 0xffff) t->dwell++;
+  if (in == 0) {
+    t->spent = 0;
+  } else if (in != (TRACE_IN_R | TRACE_IN_L) || next == TRACE_EDGE_LEFT || next == TRACE_EDGE_RIGHT) {
+    if (t->spent != 0xffff) t->spent++;
+  }
+  return next;
+}
+
+int trace_cmd(int state)
+     /* 状態のモータの指令を返す関数 */
+{
+  return trace_def[state].cmd;
+}
+
+const char *trace_name(int state)
+     /* 状態の名前を返す関数 */
+{
+  return trace_def[state].name;
+}
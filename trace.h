@@ -0,0 +1,56 @@
+// trace.c を利用するために必要なヘッダファイル
+// ライントレースの状態機械 (交差点, 線の途切れ, その場旋回)
+//
+// 2個の白黒判定を入力として状態を遷移させ, 状態ごとに決まったモータの
+// 指令(TRACE_CMD_xxx)を control_proc() が実行する
+// 遷移は trace.c の状態表を1回引くだけなので1周期あたり定数時間で,
+// 振る舞いは分岐の順序ではなく状態表で決まる
+// 滞在時間は trace_update() の呼び出し回数で, 1ms 周期で呼べば ms 単位になる
+
+/* 状態 */
+#define TRACE_TRACKING   0   /* 両方白 (ラインを挟んでいる) */
+#define TRACE_EDGE_LEFT  1   /* 左のセンサ(AN2)だけ黒, 左へ曲がる */
+#define TRACE_EDGE_RIGHT 2   /* 右のセンサ(AN1)だけ黒, 右へ曲がる */
+#define TRACE_GAP        3   /* 横線を越えた後の線の途切れ, 直進する */
+#define TRACE_TURN_LEFT  4   /* 横線で左にその場旋回する */
+#define TRACE_TURN_RIGHT 5   /* 横線で右にその場旋回する */
+#define TRACE_CROSSING   6   /* 横線(交差点)を直進で越える */
+#define TRACE_NUM        7
+
+/* 入力 (白黒の判定, 黒のビットを立てる) */
+#define TRACE_IN_R 0x01      /* sensor_r (AN2, ロボットの左側) が黒 */
+#define TRACE_IN_L 0x02      /* sensor_l (AN1, ロボットの右側) が黒 */
+#define TRACE_IN_NUM 4
+
+/* 状態ごとのモータの指令                                        */
+/*   TRACE_CMD_TRACK から TRACE_CMD_EDGE_R まではラインに沿って走る */
+#define TRACE_CMD_TRACK    0 /* 直進 (STEER_PID のときは PID) */
+#define TRACE_CMD_EDGE_L   1 /* 左の車輪を spent に比例して減速 (STEER_PID のときは PID) */
+#define TRACE_CMD_EDGE_R   2 /* 右の車輪を spent に比例して減速 (STEER_PID のときは PID) */
+#define TRACE_CMD_STRAIGHT 3 /* 両輪とも最大速度で直進 */
+#define TRACE_CMD_SPIN_L   4 /* 左の車輪を逆転してその場旋回 */
+#define TRACE_CMD_SPIN_R   5 /* 右の車輪を逆転してその場旋回 */
+
+struct trace {
+  unsigned char state;       /* 今の状態 */
+  unsigned short dwell;      /* 今の状態での滞在時間 (入った周期が 1) */
+  unsigned short spent;      /* 片側が黒になってからの時間 (両方白で 0) */
+  unsigned long white;       /* 両方白だった周期の履歴 (hist.h) */
+};
+
+#define trace_state(t) ((t)->state)
+     /* 今の状態を返す */
+#define trace_dwell(t) ((t)->dwell)
+     /* 今の状態での滞在時間を返す */
+#define trace_spent(t) ((t)->spent)
+     /* 片側が黒になってからの時間を返す (EDGE の減速に使う) */
+
+extern void trace_init(struct trace *t);
+     /* TRACE_TRACKING から始める */
+extern int trace_update(struct trace *t, int in, int jumpmode);
+     /* 入力 in (TRACE_IN_xxx の組み合わせ) で1周期分遷移し, 新しい状態を返す */
+     /* 横線を見つけたときの行き先は jumpmode (JUMPMODE_xxx) で決まる        */
+extern int trace_cmd(int state);
+     /* 状態 state でのモータの指令 (TRACE_CMD_xxx) を返す */
+extern const char *trace_name(int state);
+     /* 状態 state の LCD に表示する名前(2文字)を返す */